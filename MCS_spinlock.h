@@ -1,11 +1,12 @@
 #pragma once
 
+#include "lock_stats.h"
 #include "spinlock_pause.h"
 
 #include <atomic>
 #include <thread>
 
-template <template <typename T> class Atomic = std::atomic>
+template <template <typename T> class Atomic = std::atomic, class Stats = NoLockStats>
 class MCSSpinLock {
  public:
   class Guard {
@@ -21,28 +22,35 @@ class MCSSpinLock {
 
    private:
     void Acquire() {
-      Guard* prev_tail = spinlock_.wait_queue_tail_.exchange(this);
+      auto probe = spinlock_.stats_.BeginAcquire();
+      // (1) acq_rel: publishes our node to the successor,
+      // acquires the predecessor's node
+      Guard* prev_tail = spinlock_.wait_queue_tail_.exchange(this, std::memory_order_acq_rel);
       if (!prev_tail) {
-        is_owner_.store(true);
+        is_owner_.store(true, std::memory_order_relaxed);
       } else {
-        prev_tail->next_.store(this);
+        prev_tail->next_.store(this, std::memory_order_release); // (2)
       }
-      while(!is_owner_.load()) {
+      while(!is_owner_.load(std::memory_order_acquire)) { // (3) pairs with (6)
         //relax
+        probe.Spin();
       }
+      spinlock_.stats_.EndAcquire(probe);
     }
 
     void Release() {
-      if (!next_.load()) {
+      spinlock_.stats_.Release();
+      if (!next_.load(std::memory_order_acquire)) { // (4) pairs with (2)
         auto me = this;
-        if (spinlock_.wait_queue_tail_.compare_exchange_strong(me, nullptr)) {
+        if (spinlock_.wait_queue_tail_.compare_exchange_strong(
+                me, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
           return ;
         }
-        while(!next_.load()) {
+        while(!next_.load(std::memory_order_acquire)) { // (5) pairs with (2)
           //relax
         }
       }
-      next_.load()->is_owner_.store(true);
+      next_.load(std::memory_order_relaxed)->is_owner_.store(true, std::memory_order_release); // (6)
     }
 
    private:
@@ -52,8 +60,14 @@ class MCSSpinLock {
     Atomic<Guard*> next_{nullptr};
   };
 
+ public:
+  Stats& GetStats() {
+    return stats_;
+  }
+
  private:
   Atomic<Guard*> wait_queue_tail_{nullptr};
+  [[no_unique_address]] Stats stats_;
 };
 
 // alias for checker
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "blocking_queue.h"
+#include "thread_pool.h"
+
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// C++20 awaitable counterparts of BlockingQueue, Semaphore and CyclicBarrier:
+// a waiting coroutine is suspended instead of blocking its thread.
+//
+//   std::optional<Request> request = co_await queue.Get();
+//   co_await semaphore.Acquire();
+//   co_await barrier.Arrive();
+//
+// The awaiter lives in the coroutine frame and is itself the waiter node of
+// an intrusive FIFO and the ThreadPool task that resumes it, so suspending
+// and resuming allocate nothing. A woken coroutine is resumed through
+// Executor::Execute(waiter), called outside the lock: InlineExecutor resumes
+// it on the waking thread, ThreadPoolExecutor posts it to a ThreadPool, or
+// resumes it inline once the pool is shut down. A coroutine that does not
+// need to wait is not suspended at all.
+
+struct AsyncWaiter : ThreadPool::TaskNode {
+  void Run() override {
+    handle_.resume();
+  }
+
+  AsyncWaiter* next_ = nullptr;
+  std::coroutine_handle<> handle_;
+};
+
+// intrusive FIFO of suspended awaiters, guarded by the owner's mutex
+// or local to a thread
+class AsyncWaiterList {
+ public:
+  bool Empty() const {
+    return head_ == nullptr;
+  }
+
+  void PushBack(AsyncWaiter* waiter) {
+    waiter->next_ = nullptr;
+    if (tail_) {
+      tail_->next_ = waiter;
+    } else {
+      head_ = waiter;
+    }
+    tail_ = waiter;
+  }
+
+  AsyncWaiter* PopFront() {
+    AsyncWaiter* waiter = head_;
+    head_ = waiter->next_;
+    if (!head_) {
+      tail_ = nullptr;
+    }
+    return waiter;
+  }
+
+  // detaches the whole list, walk it with next_
+  AsyncWaiter* TakeAll() {
+    AsyncWaiter* all = head_;
+    head_ = tail_ = nullptr;
+    return all;
+  }
+
+ private:
+  AsyncWaiter* head_ = nullptr;
+  AsyncWaiter* tail_ = nullptr;
+};
+
+// Resumes on the waking thread. A resumed coroutine that wakes the next
+// waiter (co_await Acquire(); Release();) would resume it one frame deeper,
+// so the stack would grow with the queue. Instead, waiters woken during a
+// resume are queued on the thread and the outermost Execute resumes them
+// one after another.
+struct InlineExecutor {
+  void Execute(AsyncWaiter* waiter) {
+    static thread_local AsyncWaiterList* woken = nullptr;
+    if (woken) {
+      woken->PushBack(waiter);
+      return;
+    }
+    AsyncWaiterList pending;
+    woken = &pending;
+    struct Reset {
+      ~Reset() {
+        woken = nullptr;
+      }
+    } reset;
+    waiter->Run();
+    while (!pending.Empty()) {
+      pending.PopFront()->Run();
+    }
+  }
+};
+
+class ThreadPoolExecutor {
+ public:
+  explicit ThreadPoolExecutor(ThreadPool& pool) : pool_(&pool) {}
+
+  void Execute(AsyncWaiter* waiter) {
+    // the waiter is already off its list: never drop it
+    if (!pool_->TrySchedule(waiter)) {
+      InlineExecutor().Execute(waiter);
+    }
+  }
+
+ private:
+  ThreadPool* pool_;
+};
+
+// Unbounded MPMC queue: Put never suspends, Get suspends while empty.
+// After Shutdown, Put throws and Get drains, then yields std::nullopt.
+
+template <class T, class Executor = InlineExecutor>
+class AsyncQueue {
+  struct GetWaiter : AsyncWaiter {
+    std::optional<T> result_;
+  };
+
+ public:
+  class GetAwaiter : private GetWaiter {
+   public:
+    explicit GetAwaiter(AsyncQueue& queue) : queue_(queue) {}
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::unique_lock<std::mutex> lock(queue_.mutex_);
+      if (!queue_.elements_.empty()) {
+        this->result_.emplace(std::move(queue_.elements_.front()));
+        queue_.elements_.pop_front();
+        return false;
+      }
+      if (queue_.is_shutdown_) {
+        return false;
+      }
+      this->handle_ = handle;
+      queue_.waiters_.PushBack(this);
+      // from here on another thread may resume and destroy us
+      return true;
+    }
+
+    std::optional<T> await_resume() {
+      return std::move(this->result_);
+    }
+
+   private:
+    AsyncQueue& queue_;
+  };
+
+  explicit AsyncQueue(Executor executor = Executor())
+      : executor_(std::move(executor)) {}
+
+  void Put(T &&element) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (is_shutdown_) {
+      throw ShutdownQueueException();
+    }
+    if (waiters_.Empty()) {
+      elements_.push_back(std::move(element));
+      return;
+    }
+    // hand the element straight to the oldest waiter
+    auto* waiter = static_cast<GetWaiter*>(waiters_.PopFront());
+    waiter->result_.emplace(std::move(element));
+    lock.unlock();
+    executor_.Execute(waiter);
+  }
+
+  GetAwaiter Get() {
+    return GetAwaiter(*this);
+  }
+
+  void Shutdown() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_shutdown_ = true;
+    AsyncWaiter* waiter = waiters_.TakeAll();
+    lock.unlock();
+    // waiters exist only while the queue is empty: they all get nullopt
+    while (waiter) {
+      AsyncWaiter* next = waiter->next_;
+      executor_.Execute(waiter);
+      waiter = next;
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<T> elements_;
+  AsyncWaiterList waiters_;
+  bool is_shutdown_ = false;
+  [[no_unique_address]] Executor executor_;
+};
+
+// Counting semaphore: Acquire suspends while no permit is left,
+// Release hands its permit to the oldest waiter.
+
+template <class Executor = InlineExecutor>
+class AsyncSemaphore {
+ public:
+  class AcquireAwaiter : private AsyncWaiter {
+   public:
+    explicit AcquireAwaiter(AsyncSemaphore& semaphore) : semaphore_(semaphore) {}
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::unique_lock<std::mutex> lock(semaphore_.mutex_);
+      if (semaphore_.permits_ > 0) {
+        --semaphore_.permits_;
+        return false;
+      }
+      handle_ = handle;
+      semaphore_.waiters_.PushBack(this);
+      return true;
+    }
+
+    void await_resume() const noexcept {}
+
+   private:
+    AsyncSemaphore& semaphore_;
+  };
+
+  explicit AsyncSemaphore(const size_t permits, Executor executor = Executor())
+      : permits_(permits), executor_(std::move(executor)) {}
+
+  AcquireAwaiter Acquire() {
+    return AcquireAwaiter(*this);
+  }
+
+  bool TryAcquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (permits_ == 0) {
+      return false;
+    }
+    --permits_;
+    return true;
+  }
+
+  void Release() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (waiters_.Empty()) {
+      ++permits_;
+      return;
+    }
+    AsyncWaiter* waiter = waiters_.PopFront();
+    lock.unlock();
+    executor_.Execute(waiter);
+  }
+
+ private:
+  std::mutex mutex_;
+  size_t permits_;
+  AsyncWaiterList waiters_;
+  [[no_unique_address]] Executor executor_;
+};
+
+// Cyclic barrier: the last of num_participants arrivals continues without
+// suspending and resumes the others, then the barrier is ready for the
+// next round.
+
+template <class Executor = InlineExecutor>
+class AsyncBarrier {
+ public:
+  class ArriveAwaiter : private AsyncWaiter {
+   public:
+    explicit ArriveAwaiter(AsyncBarrier& barrier) : barrier_(barrier) {}
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::unique_lock<std::mutex> lock(barrier_.mutex_);
+      if (++barrier_.arrived_ < barrier_.num_participants_) {
+        handle_ = handle;
+        barrier_.waiters_.PushBack(this);
+        return true;
+      }
+      barrier_.arrived_ = 0;
+      AsyncWaiter* waiter = barrier_.waiters_.TakeAll();
+      lock.unlock();
+      while (waiter) {
+        AsyncWaiter* next = waiter->next_;
+        barrier_.executor_.Execute(waiter);
+        waiter = next;
+      }
+      return false;
+    }
+
+    void await_resume() const noexcept {}
+
+   private:
+    AsyncBarrier& barrier_;
+  };
+
+  explicit AsyncBarrier(const size_t num_participants, Executor executor = Executor())
+      : num_participants_(num_participants), executor_(std::move(executor)) {}
+
+  ArriveAwaiter Arrive() {
+    return ArriveAwaiter(*this);
+  }
+
+ private:
+  std::mutex mutex_;
+  const size_t num_participants_;
+  size_t arrived_ = 0;
+  AsyncWaiterList waiters_;
+  [[no_unique_address]] Executor executor_;
+};
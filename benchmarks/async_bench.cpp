@@ -0,0 +1,208 @@
+// Tens of thousands of coroutines waiting on AsyncQueue, AsyncSemaphore and
+// AsyncBarrier, resumed on a small ThreadPool, and an AsyncSemaphore on the
+// default InlineExecutor. Each scenario checks its invariant and the run
+// fails if one breaks.
+//
+//   g++ -O2 -std=c++20 -pthread -I.. async_bench.cpp
+//   ./a.out [coroutines] [workers]
+
+#include "bench_common.h"
+
+#include "async_primitives.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <latch>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// fire-and-forget coroutine, runs eagerly until its first suspension
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+};
+
+// resumes the coroutine on a pool worker
+struct Hop : AsyncWaiter {
+  explicit Hop(ThreadPoolExecutor executor) : executor_(executor) {}
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    executor_.Execute(this);
+  }
+  void await_resume() const noexcept {}
+
+  ThreadPoolExecutor executor_;
+};
+
+using Queue = AsyncQueue<uint64_t, ThreadPoolExecutor>;
+using Semaphore = AsyncSemaphore<ThreadPoolExecutor>;
+using Barrier = AsyncBarrier<ThreadPoolExecutor>;
+using InlineSemaphore = AsyncSemaphore<>;
+
+Detached Consume(Queue& queue, std::atomic<uint64_t>& sum, std::latch& done) {
+  while (std::optional<uint64_t> element = co_await queue.Get()) {
+    sum.fetch_add(*element, std::memory_order_relaxed);
+  }
+  done.count_down();
+}
+
+Detached Limit(ThreadPool& pool, Semaphore& semaphore, const size_t rounds, const size_t permits,
+               std::atomic<size_t>& inside, std::atomic<bool>& ok, std::latch& done) {
+  co_await Hop(ThreadPoolExecutor(pool));
+  for (size_t i = 0; i < rounds; ++i) {
+    co_await semaphore.Acquire();
+    if (inside.fetch_add(1) >= permits) {
+      ok.store(false);
+    }
+    inside.fetch_sub(1);
+    semaphore.Release();
+  }
+  done.count_down();
+}
+
+Detached Relay(InlineSemaphore& semaphore, const size_t rounds, size_t& inside, bool& ok,
+                size_t& finished) {
+  for (size_t i = 0; i < rounds; ++i) {
+    co_await semaphore.Acquire();
+    ok = inside++ == 0 && ok;
+    --inside;
+    semaphore.Release();
+  }
+  ++finished;
+}
+
+Detached March(Barrier& barrier, const size_t rounds, std::vector<std::atomic<size_t>>& arrived,
+               const size_t num_participants, std::atomic<bool>& ok, std::latch& done) {
+  for (size_t round = 0; round < rounds; ++round) {
+    arrived[round].fetch_add(1);
+    co_await barrier.Arrive();
+    if (arrived[round].load() != num_participants) {
+      ok.store(false);
+    }
+  }
+  done.count_down();
+}
+
+bool RunQueue(const size_t coroutines, const size_t workers) {
+  constexpr uint64_t kElements = 1 << 20;
+  ThreadPool pool(workers);
+  Queue queue{ThreadPoolExecutor(pool)};
+  std::atomic<uint64_t> sum{0};
+  std::latch done(static_cast<ptrdiff_t>(coroutines));
+  for (size_t i = 0; i < coroutines; ++i) {
+    Consume(queue, sum, done);
+  }
+  const uint64_t start = NowNanos();
+  for (uint64_t i = 1; i <= kElements; ++i) {
+    queue.Put(uint64_t{i});
+  }
+  queue.Shutdown();
+  done.wait();
+  const double seconds = (NowNanos() - start) / 1e9;
+  std::cout << "queue," << coroutines << "," << workers << "," << kElements / seconds << std::endl;
+  return sum.load() == kElements * (kElements + 1) / 2;
+}
+
+bool RunSemaphore(const size_t coroutines, const size_t workers) {
+  constexpr size_t kRounds = 32;
+  constexpr size_t kPermits = 4;
+  ThreadPool pool(workers);
+  Semaphore semaphore(kPermits, ThreadPoolExecutor(pool));
+  std::atomic<size_t> inside{0};
+  std::atomic<bool> ok{true};
+  std::latch done(static_cast<ptrdiff_t>(coroutines));
+  const uint64_t start = NowNanos();
+  for (size_t i = 0; i < coroutines; ++i) {
+    Limit(pool, semaphore, kRounds, kPermits, inside, ok, done);
+  }
+  done.wait();
+  const double seconds = (NowNanos() - start) / 1e9;
+  std::cout << "semaphore," << coroutines << "," << workers << ","
+            << coroutines * kRounds / seconds << std::endl;
+  return ok.load();
+}
+
+// every coroutine queues behind a held permit, then each Release wakes the
+// next waiter on the same thread: the stack must not grow with the queue
+bool RunInlineSemaphore(const size_t coroutines) {
+  constexpr size_t kRounds = 32;
+  InlineSemaphore semaphore(1);
+  semaphore.TryAcquire();
+  size_t inside = 0;
+  bool ok = true;
+  size_t finished = 0;
+  const uint64_t start = NowNanos();
+  for (size_t i = 0; i < coroutines; ++i) {
+    Relay(semaphore, kRounds, inside, ok, finished);
+  }
+  semaphore.Release();
+  const double seconds = (NowNanos() - start) / 1e9;
+  std::cout << "inline_semaphore," << coroutines << ",0," << coroutines * kRounds / seconds
+            << std::endl;
+  return ok && finished == coroutines;
+}
+
+bool RunBarrier(const size_t coroutines, const size_t workers) {
+  constexpr size_t kRounds = 16;
+  ThreadPool pool(workers);
+  Barrier barrier(coroutines, ThreadPoolExecutor(pool));
+  std::vector<std::atomic<size_t>> arrived(kRounds);
+  std::atomic<bool> ok{true};
+  std::latch done(static_cast<ptrdiff_t>(coroutines));
+  const uint64_t start = NowNanos();
+  for (size_t i = 0; i < coroutines; ++i) {
+    March(barrier, kRounds, arrived, coroutines, ok, done);
+  }
+  done.wait();
+  const double seconds = (NowNanos() - start) / 1e9;
+  std::cout << "barrier," << coroutines << "," << workers << ","
+            << coroutines * kRounds / seconds << std::endl;
+  return ok.load();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t coroutines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+  const size_t workers = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+
+  std::cout << "primitive,coroutines,workers,ops_per_sec" << std::endl;
+  if (!RunQueue(coroutines, workers)) {
+    std::cerr << "queue: element lost or delivered twice" << std::endl;
+    return 1;
+  }
+  if (!RunSemaphore(coroutines, workers)) {
+    std::cerr << "semaphore: more holders than permits" << std::endl;
+    return 1;
+  }
+  if (!RunInlineSemaphore(coroutines)) {
+    std::cerr << "inline semaphore: more holders than permits or a coroutine stuck" << std::endl;
+    return 1;
+  }
+  if (!RunBarrier(coroutines, workers)) {
+    std::cerr << "barrier: a coroutine passed before all arrived" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// Helpers shared by the standalone benchmarks
+
+inline uint64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Pins the calling thread to cpu % (number of online cpus)
+inline void PinThisThread(const size_t cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  CPU_SET(cpu % static_cast<size_t>(num_cpus > 0 ? num_cpus : 1), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Swallows std::cout output of the course Robots while measuring
+class SilenceStdout {
+ public:
+  SilenceStdout() : saved_(std::cout.rdbuf(&null_buffer_)) {}
+  ~SilenceStdout() {
+    std::cout.rdbuf(saved_);
+  }
+
+ private:
+  class NullBuffer : public std::streambuf {
+   protected:
+    int overflow(int ch) override {
+      return ch;
+    }
+  };
+
+  NullBuffer null_buffer_;
+  std::streambuf* saved_;
+};
+
+// q in [0, 1]; sorts the samples in place
+inline uint64_t Percentile(std::vector<uint64_t>& samples, const double q) {
+  if (samples.empty()) {
+    return 0;
+  }
+  const size_t rank = std::min(samples.size() - 1,
+                               static_cast<size_t>(q * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+struct TimedResult {
+  double ops_per_second = 0;
+  uint64_t p50_nanos = 0;
+  uint64_t p99_nanos = 0;
+  uint64_t p999_nanos = 0;
+  // per-thread op spread: min/max and coefficient of variation
+  double min_max_ratio = 0;
+  double ops_cv = 0;
+};
+
+// Runs op(thread_index, random) on num_threads pinned threads for
+// duration_ms; an op returning false stops its thread early.
+// on_stop runs on the main thread once time is up (e.g. to shut a queue
+// down so blocked threads can leave). Every 8th op is timed.
+template <class Op>
+TimedResult RunTimed(const size_t num_threads, const uint64_t duration_ms, Op op,
+                     const std::function<void()>& on_stop = {}) {
+  constexpr uint64_t kLatencySamplePeriod = 8;
+
+  struct alignas(64) PerThread {
+    uint64_t ops = 0;
+    std::vector<uint64_t> latencies;
+  };
+  std::vector<PerThread> results(num_threads);
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      PinThisThread(t);
+      std::mt19937_64 random(t * 7919 + 17);
+      PerThread& result = results[t];
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (result.ops % kLatencySamplePeriod == 0) {
+          const uint64_t start = NowNanos();
+          if (!op(t, random)) {
+            break;
+          }
+          result.latencies.push_back(NowNanos() - start);
+        } else if (!op(t, random)) {
+          break;
+        }
+        ++result.ops;
+      }
+    });
+  }
+
+  while (ready.load() < num_threads) {
+    std::this_thread::yield();
+  }
+  const uint64_t start = NowNanos();
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  stop.store(true);
+  const uint64_t elapsed = NowNanos() - start;
+  if (on_stop) {
+    on_stop();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TimedResult summary;
+  std::vector<uint64_t> latencies;
+  uint64_t total_ops = 0;
+  uint64_t min_ops = ~uint64_t{0};
+  uint64_t max_ops = 0;
+  for (const PerThread& result : results) {
+    total_ops += result.ops;
+    min_ops = std::min(min_ops, result.ops);
+    max_ops = std::max(max_ops, result.ops);
+    latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+  }
+  const double mean = static_cast<double>(total_ops) / num_threads;
+  double variance = 0;
+  for (const PerThread& result : results) {
+    variance += (result.ops - mean) * (result.ops - mean) / num_threads;
+  }
+  summary.ops_per_second = total_ops * 1e9 / elapsed;
+  summary.p50_nanos = Percentile(latencies, 0.5);
+  summary.p99_nanos = Percentile(latencies, 0.99);
+  summary.p999_nanos = Percentile(latencies, 0.999);
+  summary.min_max_ratio = max_ops ? static_cast<double>(min_ops) / max_ops : 0;
+  summary.ops_cv = mean > 0 ? std::sqrt(variance) / mean : 0;
+  return summary;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const TimedResult& result) {
+  return out << result.ops_per_second << "," << result.p50_nanos << ","
+             << result.p99_nanos << "," << result.p999_nanos << ","
+             << result.min_max_ratio << "," << result.ops_cv;
+}
+
+inline constexpr const char* kTimedResultCsvHeader =
+    "ops_per_sec,p50_ns,p99_ns,p999_ns,fairness_min_max,fairness_cv";
+
+// Busy work of roughly `units` dependent adds, not optimized away
+inline void BusyWork(const size_t units) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < units; ++i) {
+    value += i;
+    asm volatile("" : "+r"(value));
+  }
+}
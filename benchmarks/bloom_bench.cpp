@@ -0,0 +1,115 @@
+// StripedHashSet Contains with and without the BlockedBloomFilter front,
+// at several miss ratios. The set holds keys [0, keys); misses are drawn
+// far above that range. A churn phase then inserts and removes keys to
+// force filter rebuilds under concurrent readers; a reader missing a key
+// that was never removed fails the run.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. bloom_bench.cpp
+//   ./a.out [keys] [threads] [duration_ms]
+
+#include "bench_common.h"
+
+#include "hash_set.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+using PlainSet = StripedHashSet<uint64_t>;
+using FilteredSet = StripedHashSet<uint64_t, std::hash<uint64_t>, BlockedBloomFilter>;
+
+constexpr uint64_t kMissBase = uint64_t{1} << 40;
+
+template <class Set>
+void Fill(Set& set, const uint64_t num_keys) {
+  for (uint64_t key = 0; key < num_keys; ++key) {
+    set.Insert(key);
+  }
+}
+
+template <class Set>
+TimedResult RunLookups(Set& set, const uint64_t num_keys, const double miss_ratio,
+                       const size_t threads, const uint64_t duration_ms,
+                       std::atomic<bool>& wrong) {
+  return RunTimed(threads, duration_ms, [&](size_t, std::mt19937_64& random) {
+    const bool miss = std::uniform_real_distribution<double>(0.0, 1.0)(random) < miss_ratio;
+    const uint64_t key = miss ? kMissBase + random() % kMissBase : random() % num_keys;
+    if (set.Contains(key) == miss) {
+      wrong.store(true);
+      return false;
+    }
+    return true;
+  });
+}
+
+double FalsePositiveRate(FilteredSet& set) {
+  constexpr uint64_t kProbes = 1 << 20;
+  uint64_t positives = 0;
+  for (uint64_t i = 0; i < kProbes; ++i) {
+    positives += set.GetFilter().MayContain(std::hash<uint64_t>()(kMissBase + i));
+  }
+  return static_cast<double>(positives) / kProbes;
+}
+
+// readers look up stable keys [0, keys) while writers insert and remove
+// [keys, 2 keys), so removals keep triggering rebuilds
+bool RunChurn(const uint64_t num_keys, const size_t threads, const uint64_t duration_ms) {
+  FilteredSet set(64);
+  Fill(set, num_keys);
+  std::atomic<bool> lost{false};
+  const TimedResult result = RunTimed(std::max<size_t>(threads, 2), duration_ms,
+                                      [&](size_t thread, std::mt19937_64& random) {
+    if (thread % 2 == 0) {
+      const uint64_t key = num_keys + random() % num_keys;
+      if (random() & 1) {
+        set.Insert(key);
+      } else {
+        set.Remove(key);
+      }
+    } else if (!set.Contains(random() % num_keys)) {
+      lost.store(true);
+      return false;
+    }
+    return true;
+  });
+  std::cout << "churn," << result.ops_per_second << ",filter_capacity="
+            << set.GetFilter().Capacity() << std::endl;
+  return !lost.load();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint64_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 16;
+  const size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+  const uint64_t duration_ms = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 300;
+
+  PlainSet plain(64);
+  FilteredSet filtered(64);
+  Fill(plain, num_keys);
+  Fill(filtered, num_keys);
+  std::cout << "false_positive_rate," << FalsePositiveRate(filtered) << std::endl;
+
+  std::atomic<bool> wrong{false};
+  std::cout << "set,miss_ratio," << kTimedResultCsvHeader << std::endl;
+  for (const double miss_ratio : {0.0, 0.5, 0.9, 0.95, 0.99}) {
+    std::cout << "plain," << miss_ratio << ","
+              << RunLookups(plain, num_keys, miss_ratio, threads, duration_ms, wrong) << std::endl;
+    std::cout << "bloom," << miss_ratio << ","
+              << RunLookups(filtered, num_keys, miss_ratio, threads, duration_ms, wrong) << std::endl;
+  }
+
+  if (wrong.load()) {
+    std::cerr << "Contains gave a wrong answer" << std::endl;
+    return 1;
+  }
+  if (!RunChurn(num_keys, threads, duration_ms)) {
+    std::cerr << "a key that was never removed was not found" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Steal throughput of ChaseLevDeque: one owner pushes (and sometimes pops),
+// the other threads steal. Every element must be taken exactly once,
+// the run fails otherwise, so it doubles as a stress check for resizing.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. chase_lev_bench.cpp
+//   ./a.out [elements] [max_thieves]
+
+#include "bench_common.h"
+
+#include "chase_lev_deque.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Result {
+  double steals_per_second;
+  uint64_t stolen;
+  uint64_t popped;
+  bool valid;
+};
+
+Result Run(const size_t num_elements, const size_t num_thieves, const size_t pop_every) {
+  // small initial buffer to exercise Resize under steals
+  ChaseLevDeque<uint32_t> deque(2);
+  std::unique_ptr<std::atomic<uint8_t>[]> taken(new std::atomic<uint8_t>[num_elements]);
+  for (size_t i = 0; i < num_elements; ++i) {
+    taken[i].store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<bool> owner_done{false};
+  std::atomic<uint64_t> stolen{0};
+  uint64_t popped = 0;
+
+  std::vector<std::thread> thieves;
+  const uint64_t start = NowNanos();
+  for (size_t t = 0; t < num_thieves; ++t) {
+    thieves.emplace_back([&, t]() {
+      PinThisThread(t + 1);
+      uint64_t local_stolen = 0;
+      uint32_t element = 0;
+      while (true) {
+        if (deque.Steal(element)) {
+          taken[element].fetch_add(1, std::memory_order_relaxed);
+          ++local_stolen;
+        } else if (owner_done.load(std::memory_order_acquire) && deque.Empty()) {
+          break;
+        }
+      }
+      stolen.fetch_add(local_stolen);
+    });
+  }
+
+  PinThisThread(0);
+  uint32_t element = 0;
+  for (size_t i = 0; i < num_elements; ++i) {
+    deque.Push(static_cast<uint32_t>(i));
+    if (pop_every && i % pop_every == 0 && deque.Pop(element)) {
+      taken[element].fetch_add(1, std::memory_order_relaxed);
+      ++popped;
+    }
+  }
+  if (num_thieves == 0) {
+    while (deque.Pop(element)) {
+      taken[element].fetch_add(1, std::memory_order_relaxed);
+      ++popped;
+    }
+  }
+  owner_done.store(true, std::memory_order_release);
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  const uint64_t elapsed = NowNanos() - start;
+
+  bool valid = stolen.load() + popped == num_elements;
+  for (size_t i = 0; i < num_elements && valid; ++i) {
+    valid = taken[i].load(std::memory_order_relaxed) == 1;
+  }
+  return Result{stolen.load() * 1e9 / elapsed, stolen.load(), popped, valid};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t num_elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  const size_t max_thieves = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                                      : std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+  std::cout << "thieves,pop_every,steals_per_sec,stolen,popped" << std::endl;
+  for (size_t thieves = 1; thieves <= max_thieves; thieves *= 2) {
+    for (size_t pop_every : {0, 4}) {
+      const Result result = Run(num_elements, thieves, pop_every);
+      std::cout << thieves << "," << pop_every << "," << result.steals_per_second << ","
+                << result.stolen << "," << result.popped << std::endl;
+      if (!result.valid) {
+        std::cerr << "element lost or taken twice" << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
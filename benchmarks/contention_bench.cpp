@@ -0,0 +1,413 @@
+// Contention benchmark matrix over the primitives of the repo.
+// Prints one CSV row per (primitive, threads, critical section, read ratio,
+// key distribution, queue capacity) combination.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. contention_bench.cpp
+//   ./a.out --primitives=tas,mcs,striped_set --threads=1,2,4,8
+//           --cs=0,100 --reads=0.5,0.9 --dist=uniform,zipf --capacity=16,1024
+//
+// Options (comma-separated lists form the matrix):
+//   --primitives  tas, mcs, tree, rwlock, list_spinlock (locks),
+//                 striped_set, optimistic_set, fc_set (sets),
+//                 blocking_queue, lock_free_queue, spsc,
+//                 lock_free_stack, fc_stack (queues/stacks)
+//   --threads     thread counts, threads are pinned round-robin to cores
+//   --cs          critical-section length in busy-work units (locks)
+//   --reads       share of read operations (rwlock: read_lock, sets: Contains)
+//   --dist        uniform or zipf key distribution (sets)
+//   --keys        key range of the sets
+//   --capacity    queue capacity (blocking_queue, spsc)
+//   --duration_ms time per combination
+
+#include "bench_common.h"
+#include "zipf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <forward_list>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "arena_allocator.h"
+#include "lock_stats.h"
+
+#include "MCS_spinlock.h"
+#include "blocking_queue.h"
+#include "flat_combining.h"
+#include "lock_free_queue.h"
+#include "lock_free_stack.h"
+#include "spsc_ring_buffer.h"
+#include "tas_spinlock.h"
+#include "tree_mutex.cpp"
+
+// hash_set.h and optimistic_list.h both define ConcurrentSet, and the
+// list SpinLock clashes with the MCS alias
+namespace striped {
+#include "hash_set.h"
+}
+namespace optimistic {
+#include "optimistic_list.h"
+}
+
+namespace {
+
+struct Options {
+  std::vector<std::string> primitives{"tas", "mcs", "tree", "rwlock", "list_spinlock",
+                                      "striped_set", "optimistic_set", "fc_set",
+                                      "blocking_queue", "lock_free_queue", "spsc",
+                                      "lock_free_stack", "fc_stack"};
+  std::vector<size_t> threads{1, 2, 4};
+  std::vector<size_t> cs_lengths{0, 100};
+  std::vector<double> read_ratios{0.9};
+  std::vector<std::string> distributions{"uniform", "zipf"};
+  std::vector<size_t> capacities{16, 1024};
+  size_t num_keys = 1 << 14;
+  uint64_t duration_ms = 200;
+};
+
+struct Case {
+  std::string primitive;
+  size_t threads;
+  size_t cs_length;
+  double read_ratio;
+  std::string distribution;
+  size_t capacity;
+};
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+template <class T>
+std::vector<T> ParseList(const std::string& list) {
+  std::vector<T> values;
+  for (const std::string& item : SplitList(list)) {
+    std::stringstream stream(item);
+    T value{};
+    stream >> value;
+    values.push_back(value);
+  }
+  return values;
+}
+
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      std::cerr << "ignoring argument " << arg << std::endl;
+      continue;
+    }
+    const std::string name = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    if (name == "primitives") {
+      options.primitives = SplitList(value);
+    } else if (name == "threads") {
+      options.threads = ParseList<size_t>(value);
+    } else if (name == "cs") {
+      options.cs_lengths = ParseList<size_t>(value);
+    } else if (name == "reads") {
+      options.read_ratios = ParseList<double>(value);
+    } else if (name == "dist") {
+      options.distributions = SplitList(value);
+    } else if (name == "keys") {
+      options.num_keys = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "capacity") {
+      options.capacities = ParseList<size_t>(value);
+    } else if (name == "duration_ms") {
+      options.duration_ms = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+      std::cerr << "unknown option " << name << std::endl;
+    }
+  }
+  return options;
+}
+
+// Keys start from 1: the optimistic list reserves ElementTraits Min/Max
+class KeyGenerator {
+ public:
+  KeyGenerator(const std::string& distribution, const uint64_t num_keys)
+      : is_zipf_(distribution == "zipf"), num_keys_(num_keys), zipf_(num_keys) {}
+
+  template <class Random>
+  uint64_t operator()(Random& random) {
+    if (is_zipf_) {
+      // scatter the popular ranks over the key space (and the stripes)
+      return 1 + (zipf_(random) * 0x9E3779B97F4A7C15ull) % num_keys_;
+    }
+    return 1 + random() % num_keys_;
+  }
+
+ private:
+  bool is_zipf_;
+  uint64_t num_keys_;
+  ZipfianGenerator zipf_;
+};
+
+bool IsRead(std::mt19937_64& random, const double read_ratio) {
+  return std::uniform_real_distribution<double>(0.0, 1.0)(random) < read_ratio;
+}
+
+// ---- locks ----
+
+template <class Lock>
+TimedResult RunLock(const Case& c, const Options& options) {
+  Lock lock;
+  uint64_t shared_counter = 0;
+  return RunTimed(c.threads, options.duration_ms, [&](size_t, std::mt19937_64&) {
+    lock.Lock();
+    ++shared_counter;
+    BusyWork(c.cs_length);
+    lock.Unlock();
+    return true;
+  });
+}
+
+TimedResult RunMCS(const Case& c, const Options& options) {
+  MCSSpinLock<> lock;
+  uint64_t shared_counter = 0;
+  return RunTimed(c.threads, options.duration_ms, [&](size_t, std::mt19937_64&) {
+    MCSSpinLock<>::Guard guard(lock);
+    ++shared_counter;
+    BusyWork(c.cs_length);
+    return true;
+  });
+}
+
+TimedResult RunTree(const Case& c, const Options& options) {
+  TreeMutex lock(c.threads);
+  uint64_t shared_counter = 0;
+  return RunTimed(c.threads, options.duration_ms, [&](size_t thread, std::mt19937_64&) {
+    lock.lock(thread);
+    ++shared_counter;
+    BusyWork(c.cs_length);
+    lock.unlock(thread);
+    return true;
+  });
+}
+
+TimedResult RunRWLock(const Case& c, const Options& options) {
+  striped::RWLock lock;
+  uint64_t shared_counter = 0;
+  return RunTimed(c.threads, options.duration_ms, [&](size_t, std::mt19937_64& random) {
+    if (IsRead(random, c.read_ratio)) {
+      lock.read_lock();
+      BusyWork(c.cs_length);
+      lock.read_unlock();
+    } else {
+      lock.write_lock();
+      ++shared_counter;
+      BusyWork(c.cs_length);
+      lock.write_unlock();
+    }
+    return true;
+  });
+}
+
+// ---- sets ----
+
+template <class Set>
+TimedResult RunSet(Set& set, const Case& c, const Options& options) {
+  KeyGenerator prefill_keys("uniform", options.num_keys);
+  std::mt19937_64 prefill_random(42);
+  for (size_t i = 0; i < options.num_keys / 2; ++i) {
+    set.Insert(prefill_keys(prefill_random));
+  }
+
+  std::vector<KeyGenerator> keys(c.threads, KeyGenerator(c.distribution, options.num_keys));
+  return RunTimed(c.threads, options.duration_ms, [&](size_t thread, std::mt19937_64& random) {
+    const uint64_t key = keys[thread](random);
+    if (IsRead(random, c.read_ratio)) {
+      set.Contains(key);
+    } else if (random() & 1) {
+      set.Insert(key);
+    } else {
+      set.Remove(key);
+    }
+    return true;
+  });
+}
+
+// ---- queues ----
+
+TimedResult RunBlockingQueue(const Case& c, const Options& options) {
+  BlockingQueue<uint64_t> queue(c.capacity);
+  // even threads produce, odd threads consume
+  return RunTimed(c.threads, options.duration_ms, [&](size_t thread, std::mt19937_64&) {
+    try {
+      if (thread % 2 == 0) {
+        queue.Put(uint64_t{thread});
+        return true;
+      }
+      uint64_t element = 0;
+      return queue.Get(element);
+    } catch (const ShutdownQueueException&) {
+      return false;
+    }
+  }, [&]() { queue.Shutdown(); });
+}
+
+TimedResult RunLockFreeQueue(const Case& c, const Options& options) {
+  LockFreeQueue<uint64_t> queue;
+  // even threads produce, odd threads consume; unbounded, so no capacity
+  return RunTimed(c.threads, options.duration_ms, [&](size_t thread, std::mt19937_64&) {
+    try {
+      if (thread % 2 == 0) {
+        queue.Put(uint64_t{thread});
+        return true;
+      }
+      uint64_t element = 0;
+      return queue.Get(element);
+    } catch (const ShutdownQueueException&) {
+      return false;
+    }
+  }, [&]() { queue.Shutdown(); });
+}
+
+TimedResult RunSPSC(const Case& c, const Options& options) {
+  SPSCRingBuffer<uint64_t> ring(c.capacity);
+  std::atomic<bool> stop{false};
+  return RunTimed(2, options.duration_ms, [&](size_t thread, std::mt19937_64&) {
+    uint64_t element = thread;
+    while (!(thread == 0 ? ring.Publish(element) : ring.Consume(element))) {
+      if (stop.load(std::memory_order_relaxed)) {
+        return false;
+      }
+    }
+    return true;
+  }, [&]() { stop.store(true); });
+}
+
+template <class Stack>
+TimedResult RunStack(const Case& c, const Options& options) {
+  Stack stack;
+  return RunTimed(c.threads, options.duration_ms, [&](size_t thread, std::mt19937_64& random) {
+    if (random() & 1) {
+      stack.Push(thread);
+    } else {
+      uint64_t element = 0;
+      stack.Pop(element);
+    }
+    return true;
+  });
+}
+
+bool UsesCriticalSection(const std::string& primitive) {
+  return primitive == "tas" || primitive == "mcs" || primitive == "tree" ||
+      primitive == "rwlock" || primitive == "list_spinlock";
+}
+
+bool UsesKeys(const std::string& primitive) {
+  return primitive == "striped_set" || primitive == "optimistic_set" || primitive == "fc_set";
+}
+
+bool UsesReadRatio(const std::string& primitive) {
+  return primitive == "rwlock" || UsesKeys(primitive);
+}
+
+bool UsesCapacity(const std::string& primitive) {
+  return primitive == "blocking_queue" || primitive == "spsc";
+}
+
+bool RunCase(const Case& c, const Options& options, TimedResult& result) {
+  const std::string& p = c.primitive;
+  if (p == "tas") {
+    result = RunLock<TASSpinLock>(c, options);
+  } else if (p == "list_spinlock") {
+    result = RunLock<optimistic::SpinLock>(c, options);
+  } else if (p == "mcs") {
+    result = RunMCS(c, options);
+  } else if (p == "tree") {
+    result = RunTree(c, options);
+  } else if (p == "rwlock") {
+    result = RunRWLock(c, options);
+  } else if (p == "striped_set") {
+    striped::StripedHashSet<uint64_t> set(64);
+    result = RunSet(set, c, options);
+  } else if (p == "optimistic_set") {
+    ArenaAllocator allocator;
+    optimistic::OptimisticLinkedSet<uint64_t> set(allocator);
+    result = RunSet(set, c, options);
+  } else if (p == "fc_set") {
+    FlatCombiningSet<uint64_t> set;
+    result = RunSet(set, c, options);
+  } else if (p == "blocking_queue") {
+    result = RunBlockingQueue(c, options);
+  } else if (p == "lock_free_queue") {
+    result = RunLockFreeQueue(c, options);
+  } else if (p == "spsc") {
+    result = RunSPSC(c, options);
+  } else if (p == "lock_free_stack") {
+    result = RunStack<LockFreeStack<uint64_t>>(c, options);
+  } else if (p == "fc_stack") {
+    result = RunStack<FlatCombiningStack<uint64_t>>(c, options);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Options options = ParseOptions(argc, argv);
+
+  std::cout << "primitive,threads,cs,read_ratio,distribution,capacity,"
+            << kTimedResultCsvHeader << std::endl;
+
+  for (const std::string& primitive : options.primitives) {
+    // collapse the dimensions a primitive does not use
+    const std::vector<size_t> threads =
+        primitive == "spsc" ? std::vector<size_t>{2} : options.threads;
+    const std::vector<size_t> cs_lengths =
+        UsesCriticalSection(primitive) ? options.cs_lengths : std::vector<size_t>{0};
+    const std::vector<double> read_ratios =
+        UsesReadRatio(primitive) ? options.read_ratios : std::vector<double>{0};
+    const std::vector<std::string> distributions =
+        UsesKeys(primitive) ? options.distributions : std::vector<std::string>{"-"};
+    const std::vector<size_t> capacities =
+        UsesCapacity(primitive) ? options.capacities : std::vector<size_t>{0};
+
+    for (const size_t num_threads : threads) {
+      for (const size_t cs_length : cs_lengths) {
+        for (const double read_ratio : read_ratios) {
+          for (const std::string& distribution : distributions) {
+            for (const size_t capacity : capacities) {
+              const Case c{primitive, num_threads, cs_length, read_ratio, distribution, capacity};
+              TimedResult result;
+              if (!RunCase(c, options, result)) {
+                std::cerr << "unknown primitive " << primitive << std::endl;
+                return 1;
+              }
+              std::cout << primitive << "," << num_threads << "," << cs_length << ","
+                        << read_ratio << "," << distribution << "," << capacity << ","
+                        << result << std::endl;
+            }
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
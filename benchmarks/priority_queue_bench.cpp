@@ -0,0 +1,202 @@
+// Concurrent priority queues: a mutex around std::priority_queue, the exact
+// SkipListPriorityQueue and the relaxed MultiQueue.
+//
+// Throughput: the queue is prefilled, then every thread pushes or pops
+// with equal odds. Keys start at 1: the skip list keeps
+// ElementTraits<uint64_t>::Min() == 0 for its head. Rank error: the queue
+// is filled with the keys 1..prefill and all threads drain it; each pop
+// takes a ticket right after returning, and the rank error of a pop is the
+// number of keys popped at later tickets that are smaller, i.e. still in
+// the queue and better.
+// The ticket order only approximates the linearization order, so even the
+// exact queues show a small error at high thread counts.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. priority_queue_bench.cpp
+//   ./a.out [max_threads] [prefill] [duration_ms]
+
+#include "bench_common.h"
+
+#include "arena_allocator.h"
+#include "concurrent_priority_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+class LockedHeap {
+ public:
+  explicit LockedHeap(size_t) {}
+
+  void Push(const uint64_t element) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    heap_.push(element);
+  }
+
+  bool TryPop(uint64_t& ret_value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (heap_.empty()) {
+      return false;
+    }
+    ret_value = heap_.top();
+    heap_.pop();
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> heap_;
+};
+
+class SkipList {
+ public:
+  explicit SkipList(size_t) : queue_(allocator_) {}
+
+  void Push(const uint64_t element) {
+    queue_.Push(element);
+  }
+
+  bool TryPop(uint64_t& ret_value) {
+    return queue_.TryPop(ret_value);
+  }
+
+ private:
+  ArenaAllocator allocator_;
+  SkipListPriorityQueue<uint64_t> queue_;
+};
+
+class Relaxed {
+ public:
+  explicit Relaxed(const size_t threads) : queue_(threads) {}
+
+  void Push(const uint64_t element) {
+    queue_.Push(element);
+  }
+
+  bool TryPop(uint64_t& ret_value) {
+    return queue_.TryPop(ret_value);
+  }
+
+ private:
+  MultiQueue<uint64_t> queue_;
+};
+
+struct RankError {
+  double mean = 0;
+  uint64_t p99 = 0;
+  uint64_t max = 0;
+};
+
+// counts keys in [0, n) seen so far
+class FenwickTree {
+ public:
+  explicit FenwickTree(const size_t n) : tree_(n + 1, 0) {}
+
+  void Add(const size_t key) {
+    for (size_t i = key + 1; i < tree_.size(); i += i & (~i + 1)) {
+      ++tree_[i];
+    }
+  }
+
+  // number of added keys < key
+  uint64_t CountBelow(const size_t key) const {
+    uint64_t count = 0;
+    for (size_t i = key; i > 0; i -= i & (~i + 1)) {
+      count += tree_[i];
+    }
+    return count;
+  }
+
+ private:
+  std::vector<uint64_t> tree_;
+};
+
+template <class Queue>
+RankError MeasureRankError(const size_t threads, const uint64_t prefill) {
+  Queue queue(threads);
+  std::vector<uint64_t> keys(prefill);
+  std::iota(keys.begin(), keys.end(), 1);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+  for (const uint64_t key : keys) {
+    queue.Push(key);
+  }
+
+  // popped[ticket] = key
+  std::vector<uint64_t> popped(prefill);
+  std::atomic<uint64_t> next_ticket{0};
+  std::vector<std::thread> drainers;
+  for (size_t t = 0; t < threads; ++t) {
+    drainers.emplace_back([&, t]() {
+      PinThisThread(t);
+      uint64_t key;
+      while (queue.TryPop(key)) {
+        popped[next_ticket.fetch_add(1)] = key;
+      }
+    });
+  }
+  for (auto& drainer : drainers) {
+    drainer.join();
+  }
+
+  FenwickTree later(prefill + 1);
+  std::vector<uint64_t> errors(prefill);
+  for (uint64_t ticket = prefill; ticket-- > 0;) {
+    errors[ticket] = later.CountBelow(popped[ticket]);
+    later.Add(popped[ticket]);
+  }
+  RankError result;
+  result.mean = std::accumulate(errors.begin(), errors.end(), 0.0) / std::max<uint64_t>(prefill, 1);
+  result.max = *std::max_element(errors.begin(), errors.end());
+  result.p99 = Percentile(errors, 0.99);
+  return result;
+}
+
+template <class Queue>
+void Run(const char* name, const size_t threads, const uint64_t prefill,
+         const uint64_t duration_ms) {
+  Queue queue(threads);
+  std::mt19937_64 random(7);
+  for (uint64_t i = 0; i < prefill; ++i) {
+    queue.Push((random() >> 1) + 1);
+  }
+  const TimedResult result = RunTimed(threads, duration_ms, [&](size_t, std::mt19937_64& random) {
+    const uint64_t bits = random();
+    if (bits & 1) {
+      queue.Push((bits >> 1) + 1);
+    } else {
+      uint64_t element;
+      queue.TryPop(element);
+    }
+    return true;
+  });
+  const RankError rank_error = MeasureRankError<Queue>(threads, prefill);
+  std::cout << name << "," << threads << "," << result << "," << rank_error.mean << ","
+            << rank_error.p99 << "," << rank_error.max << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8;
+  const uint64_t prefill = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1 << 16;
+  const uint64_t duration_ms = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 300;
+
+  std::cout << "queue,threads," << kTimedResultCsvHeader
+            << ",rank_error_mean,rank_error_p99,rank_error_max" << std::endl;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    Run<LockedHeap>("locked_heap", threads, prefill, duration_ms);
+    Run<SkipList>("skiplist", threads, prefill, duration_ms);
+    Run<Relaxed>("multiqueue", threads, prefill, duration_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+// Read-mostly lookup table: RcuSnapshot against a map behind the striped
+// set's RWLock. Reader threads look up two random keys per op while one
+// writer rewrites the whole table every write_period_us. Every table
+// version stores key + version under each key, so a reader seeing two
+// versions at once fails the run.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. rcu_bench.cpp
+//   ./a.out [keys] [threads] [write_period_us] [duration_ms]
+
+#include "bench_common.h"
+
+#include "hash_set.h"
+#include "rcu_snapshot.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using Table = std::unordered_map<uint64_t, uint64_t>;
+
+Table MakeTable(const uint64_t num_keys) {
+  Table table;
+  for (uint64_t key = 0; key < num_keys; ++key) {
+    table.emplace(key, key);
+  }
+  return table;
+}
+
+void Rewrite(Table& table, const uint64_t version) {
+  for (auto& [key, value] : table) {
+    value = key + version;
+  }
+}
+
+class LockedTable {
+ public:
+  explicit LockedTable(const uint64_t num_keys) : table_(MakeTable(num_keys)) {}
+
+  bool Consistent(const uint64_t a, const uint64_t b) {
+    lock_.read_lock();
+    const bool ok = table_.at(a) - a == table_.at(b) - b;
+    lock_.read_unlock();
+    return ok;
+  }
+
+  void Update(const uint64_t version) {
+    lock_.write_lock();
+    Rewrite(table_, version);
+    lock_.write_unlock();
+  }
+
+ private:
+  RWLock lock_;
+  Table table_;
+};
+
+class RcuTable {
+ public:
+  explicit RcuTable(const uint64_t num_keys) : table_(MakeTable(num_keys)) {}
+
+  bool Consistent(const uint64_t a, const uint64_t b) {
+    auto table = table_.Read();
+    return table->at(a) - a == table->at(b) - b;
+  }
+
+  void Update(const uint64_t version) {
+    table_.Update([&](Table& table) { Rewrite(table, version); });
+  }
+
+ private:
+  RcuSnapshot<Table> table_;
+};
+
+template <class Lookup>
+bool Run(const char* name, const uint64_t num_keys, const size_t threads,
+         const uint64_t write_period_us, const uint64_t duration_ms) {
+  Lookup lookup(num_keys);
+  std::atomic<bool> torn{false};
+  std::atomic<bool> stop{false};
+  uint64_t updates = 0;
+  std::thread writer([&]() {
+    while (!stop.load()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(write_period_us));
+      lookup.Update(++updates);
+    }
+  });
+  const TimedResult result = RunTimed(threads, duration_ms, [&](size_t, std::mt19937_64& random) {
+    if (!lookup.Consistent(random() % num_keys, random() % num_keys)) {
+      torn.store(true);
+      return false;
+    }
+    return true;
+  });
+  stop.store(true);
+  writer.join();
+  std::cout << name << "," << threads << "," << updates * 1000.0 / duration_ms << ","
+            << result << std::endl;
+  return !torn.load();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint64_t num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096;
+  const size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+  const uint64_t write_period_us = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000;
+  const uint64_t duration_ms = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 500;
+
+  std::cout << "table,threads,updates_per_sec," << kTimedResultCsvHeader << std::endl;
+  if (!Run<LockedTable>("rwlock", num_keys, threads, write_period_us, duration_ms) ||
+      !Run<RcuTable>("rcu", num_keys, threads, write_period_us, duration_ms)) {
+    std::cerr << "a reader saw two table versions at once" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+// Readers of a small hot record while writers update it at a fixed rate
+// (1 MHz by default): SeqLock, MultiWriterSeqLock with two writers, and the
+// record behind the striped set's RWLock. Every written quote satisfies
+// ask == bid + 1 and size == bid * 3, so a reader seeing a torn record fails
+// the run. Readers are pinned to cpus 0..threads-1, writers after them.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. seqlock_bench.cpp
+//   ./a.out [max_threads] [write_period_ns] [duration_ms]
+
+#include "bench_common.h"
+
+#include "hash_set.h"
+#include "seqlock.h"
+#include "spin_wait.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Quote {
+  uint64_t bid = 0;
+  uint64_t ask = 1;
+  uint64_t bid_size = 0;
+  uint64_t ask_size = 0;
+};
+
+Quote MakeQuote(const uint64_t bid) {
+  return Quote{bid, bid + 1, bid * 3, bid * 3};
+}
+
+bool Consistent(const Quote& quote) {
+  return quote.ask == quote.bid + 1 && quote.bid_size == quote.bid * 3 &&
+      quote.ask_size == quote.bid_size;
+}
+
+class LockedQuote {
+ public:
+  Quote Load() {
+    lock_.read_lock();
+    const Quote quote = quote_;
+    lock_.read_unlock();
+    return quote;
+  }
+
+  void Store(const Quote& quote) {
+    lock_.write_lock();
+    quote_ = quote;
+    lock_.write_unlock();
+  }
+
+ private:
+  RWLock lock_;
+  Quote quote_;
+};
+
+template <class Record>
+bool Run(const char* name, const size_t threads, const size_t writers,
+         const uint64_t write_period_ns, const uint64_t duration_ms) {
+  Record record;
+  std::atomic<bool> torn{false};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> writes{0};
+  std::vector<std::thread> writer_threads;
+  for (size_t w = 0; w < writers; ++w) {
+    writer_threads.emplace_back([&, w]() {
+      PinThisThread(threads + w);
+      // writers take turns on a shared clock: each one writes every
+      // writers * period, so the record changes every period
+      uint64_t next = NowNanos() + w * write_period_ns;
+      uint64_t bid = w;
+      while (!stop.load(std::memory_order_relaxed)) {
+        while (NowNanos() < next) {
+          CpuRelax();
+        }
+        next += writers * write_period_ns;
+        record.Store(MakeQuote(bid));
+        bid += writers;
+        writes.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  const uint64_t start = NowNanos();
+  const TimedResult result = RunTimed(threads, duration_ms, [&](size_t, std::mt19937_64&) {
+    if (!Consistent(record.Load())) {
+      torn.store(true);
+      return false;
+    }
+    return true;
+  });
+  const double seconds = (NowNanos() - start) / 1e9;
+  stop.store(true);
+  for (auto& writer : writer_threads) {
+    writer.join();
+  }
+  std::cout << name << "," << threads << "," << writes.load() / seconds << "," << result
+            << std::endl;
+  return !torn.load();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8;
+  const uint64_t write_period_ns = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+  const uint64_t duration_ms = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 300;
+
+  std::cout << "record,readers,writes_per_sec," << kTimedResultCsvHeader << std::endl;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    if (!Run<SeqLock<Quote>>("seqlock", threads, 1, write_period_ns, duration_ms) ||
+        !Run<MultiWriterSeqLock<Quote>>("seqlock_2_writers", threads, 2, write_period_ns,
+                                        duration_ms) ||
+        !Run<LockedQuote>("rwlock", threads, 1, write_period_ns, duration_ms)) {
+      std::cerr << "a reader saw a torn quote" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Per-handoff latency of TurnSequencer against the course Robots.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. turn_sequencer_bench.cpp
+//   ./a.out [rounds]
+
+#include "bench_common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// every robot header defines its own Robot/Semaphore
+namespace robot_cv {
+#include "robot_cv.h"
+}
+namespace robot_sem {
+#include "robot_sem.h"
+}
+namespace robot_n_sem {
+#include "robot_n_sem.h"
+}
+
+#include "turn_sequencer.h"
+
+namespace {
+
+// Runs one thread per stage, each taking `rounds` turns
+template <typename StepFn>
+double MeasureHandoffNanos(const size_t num_stages, const size_t rounds, StepFn step) {
+  std::vector<std::thread> threads;
+  const uint64_t start = NowNanos();
+  for (size_t stage = 0; stage < num_stages; ++stage) {
+    threads.emplace_back([&, stage]() {
+      PinThisThread(stage);
+      for (size_t i = 0; i < rounds; ++i) {
+        step(stage);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return static_cast<double>(NowNanos() - start) / (num_stages * rounds);
+}
+
+void Report(const std::string& impl, const size_t num_stages, const double nanos) {
+  std::cout << impl << "," << num_stages << "," << nanos << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+  std::cout << "impl,stages,ns_per_handoff" << std::endl;
+  double nanos = 0;
+
+  {
+    SilenceStdout silence;
+    robot_cv::Robot robot;
+    nanos = MeasureHandoffNanos(2, rounds, [&](size_t stage) {
+      stage == 0 ? robot.StepLeft() : robot.StepRight();
+    });
+  }
+  Report("robot_cv", 2, nanos);
+
+  {
+    SilenceStdout silence;
+    robot_sem::Robot robot;
+    nanos = MeasureHandoffNanos(2, rounds, [&](size_t stage) {
+      stage == 0 ? robot.StepLeft() : robot.StepRight();
+    });
+  }
+  Report("robot_sem", 2, nanos);
+
+  for (size_t num_stages : {2, 4, 8}) {
+    {
+      SilenceStdout silence;
+      robot_n_sem::Robot robot(num_stages);
+      nanos = MeasureHandoffNanos(num_stages, rounds, [&](size_t stage) {
+        robot.Step(stage);
+      });
+    }
+    Report("robot_n_sem", num_stages, nanos);
+
+    TurnSequencer sequencer(num_stages);
+    size_t counter = 0;
+    nanos = MeasureHandoffNanos(num_stages, rounds, [&](size_t stage) {
+      sequencer.Step(stage, [&]() { ++counter; });
+    });
+    Report("turn_sequencer", num_stages, nanos);
+    if (counter != num_stages * rounds) {
+      std::cerr << "turn_sequencer lost steps" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// Zipfian keys in [0, num_keys), rank 0 is the most popular.
+// Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+// (the YCSB generator); theta close to 1 is very skewed.
+
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(const uint64_t num_keys, const double theta = 0.99)
+      : num_keys_(num_keys), theta_(theta) {
+    zeta_n_ = Zeta(num_keys_, theta_);
+    const double zeta_2 = Zeta(2, theta_);
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1.0 - std::pow(2.0 / num_keys_, 1.0 - theta_)) / (1.0 - zeta_2 / zeta_n_);
+    half_pow_theta_ = 1.0 + std::pow(0.5, theta_);
+  }
+
+  template <class Random>
+  uint64_t operator()(Random& random) {
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    const double uz = u * zeta_n_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < half_pow_theta_) {
+      return 1;
+    }
+    const uint64_t key = static_cast<uint64_t>(num_keys_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return key < num_keys_ ? key : num_keys_ - 1;
+  }
+
+ private:
+  static double Zeta(const uint64_t n, const double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+ private:
+  uint64_t num_keys_;
+  double theta_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+  double half_pow_theta_;
+};
@@ -1,60 +1,342 @@
 #pragma once
 
+#include "queue_telemetry.h"
+
 #include <exception>
-#include <deque>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <condition_variable>
+#include <type_traits>
+#include <utility>
 
 class ShutdownQueueException: public std::exception {};
 
-template <class T, class Container = std::deque<T>>
+// Fixed-capacity contiguous ring with the deque subset BlockingQueue uses.
+// Storage is allocated once by reserve(), push_back never allocates.
+template <class T>
+class FixedRing {
+ public:
+  FixedRing() = default;
+
+  ~FixedRing() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+
+  FixedRing(const FixedRing&) = delete;
+  FixedRing& operator=(const FixedRing&) = delete;
+
+  // only before the first push_back
+  void reserve(const size_t capacity) {
+    slots_.reset(new Slot[capacity]);
+    capacity_ = capacity;
+  }
+
+  void push_back(T &&element) {
+    new (slots_[tail_].storage) T(std::move(element));
+    tail_ = Next(tail_);
+    ++size_;
+  }
+
+  T& front() {
+    return *std::launder(reinterpret_cast<T*>(slots_[head_].storage));
+  }
+
+  void pop_front() {
+    front().~T();
+    head_ = Next(head_);
+    --size_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  struct Slot {
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  size_t Next(const size_t index) const {
+    return index + 1 == capacity_ ? 0 : index + 1;
+  }
+
+ private:
+  std::unique_ptr<Slot[]> slots_;
+  size_t capacity_ = 0;
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  size_t size_ = 0;
+};
+
+// Bounded MPMC queue under one mutex.
+// Condition variables are notified only when a thread is parked on them,
+// PutBatch/GetBatch move many elements per lock acquisition.
+// After Shutdown, puts throw and gets drain the remaining elements.
+
+template <class T, class Container = FixedRing<T>, class Telemetry = NoQueueTelemetry>
 class BlockingQueue {
  public:
   explicit BlockingQueue(const size_t& capacity);
   void Put(T &&element);
   bool Get(T &result);
+  // false if the queue is full
+  bool TryPut(T &&element);
+  // false if the queue is empty
+  bool TryGet(T &result);
+  template <class Rep, class Period>
+  bool TryPutFor(T &&element, const std::chrono::duration<Rep, Period>& timeout);
+  template <class Rep, class Period>
+  bool TryGetFor(T &result, const std::chrono::duration<Rep, Period>& timeout);
+  // moves all of [begin, end) in, blocking while the queue is full
+  template <class Iterator>
+  void PutBatch(Iterator begin, Iterator end);
+  // blocks for the first element, then takes up to max_count without waiting;
+  // 0 once the queue is empty and shut down
+  template <class OutputIterator>
+  size_t GetBatch(OutputIterator out, size_t max_count);
   void Shutdown();
+  Telemetry& GetTelemetry() { return telemetry_; }
+ private:
+  template <class C>
+  static auto Reserve(C& container, size_t capacity, int)
+      -> decltype(container.reserve(capacity), void()) {
+    container.reserve(capacity);
+  }
+  template <class C>
+  static void Reserve(C&, size_t, long) {}
+
+  bool CanPut() const { return container_.size() < capacity_ || is_shutdown_; }
+  bool CanGet() const { return !container_.empty() || is_shutdown_; }
+  void WaitToPut(std::unique_lock<std::mutex>& lock);
+  void WaitToGet(std::unique_lock<std::mutex>& lock);
+  void PushLocked(T &&element);
+  void PopLocked(T &result);
+  void WakeGetters(size_t count);
+  void WakePutters(size_t count);
  private:
   Container container_;
   size_t capacity_;
   bool is_shutdown_;
+  size_t put_waiters_;
+  size_t get_waiters_;
   std::mutex mutex_;
   std::condition_variable cv_put_;
   std::condition_variable cv_get_;
+  [[no_unique_address]] Telemetry telemetry_;
 };
 
-template <class T, class Container>
-BlockingQueue<T, Container>::BlockingQueue(const size_t& capacity)
-    : capacity_(capacity), is_shutdown_(false) {}
+template <class T, class Container, class Telemetry>
+BlockingQueue<T, Container, Telemetry>::BlockingQueue(const size_t& capacity)
+    : capacity_(capacity), is_shutdown_(false), put_waiters_(0), get_waiters_(0) {
+  Reserve(container_, capacity_, 0);
+}
 
-template <class T, class Container>
-void BlockingQueue<T, Container>::Put(T &&element) {
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::Put(T &&element) {
   std::unique_lock<std::mutex> lock(mutex_);
-  cv_put_.wait(lock, [&]() { return  container_.size() < capacity_ || is_shutdown_; });
+  if (!CanPut()) {
+    WaitToPut(lock);
+  }
   if (is_shutdown_) {
     throw ShutdownQueueException();
   }
-  container_.push_back(std::move(element));
-  cv_get_.notify_one();
+  PushLocked(std::move(element));
+  WakeGetters(1);
 }
 
-template <class T, class Container>
-bool BlockingQueue<T, Container>::Get(T &result) {
+template <class T, class Container, class Telemetry>
+bool BlockingQueue<T, Container, Telemetry>::Get(T &result) {
   std::unique_lock<std::mutex> lock(mutex_);
-  cv_get_.wait(lock, [&]() { return !container_.empty() || is_shutdown_; });
+  if (!CanGet()) {
+    WaitToGet(lock);
+  }
   if (container_.empty()) {
     return false;
   }
-  result = std::move(container_.front());
-  container_.pop_front();
-  cv_put_.notify_one();
+  PopLocked(result);
+  WakePutters(1);
+  return true;
+}
+
+template <class T, class Container, class Telemetry>
+bool BlockingQueue<T, Container, Telemetry>::TryPut(T &&element) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (is_shutdown_) {
+    throw ShutdownQueueException();
+  }
+  if (container_.size() >= capacity_) {
+    telemetry_.PutRejected();
+    return false;
+  }
+  PushLocked(std::move(element));
+  WakeGetters(1);
+  return true;
+}
+
+template <class T, class Container, class Telemetry>
+bool BlockingQueue<T, Container, Telemetry>::TryGet(T &result) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (container_.empty()) {
+    telemetry_.GetEmpty();
+    return false;
+  }
+  PopLocked(result);
+  WakePutters(1);
+  return true;
+}
+
+template <class T, class Container, class Telemetry>
+template <class Rep, class Period>
+bool BlockingQueue<T, Container, Telemetry>::TryPutFor(
+    T &&element, const std::chrono::duration<Rep, Period>& timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!CanPut()) {
+    auto wait_start = telemetry_.StartWait();
+    ++put_waiters_;
+    const bool ready = cv_put_.wait_for(lock, timeout, [&]() { return CanPut(); });
+    --put_waiters_;
+    telemetry_.PutBlocked(wait_start);
+    if (!ready) {
+      return false;
+    }
+  }
+  if (is_shutdown_) {
+    throw ShutdownQueueException();
+  }
+  PushLocked(std::move(element));
+  WakeGetters(1);
+  return true;
+}
+
+template <class T, class Container, class Telemetry>
+template <class Rep, class Period>
+bool BlockingQueue<T, Container, Telemetry>::TryGetFor(
+    T &result, const std::chrono::duration<Rep, Period>& timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!CanGet()) {
+    auto wait_start = telemetry_.StartWait();
+    ++get_waiters_;
+    cv_get_.wait_for(lock, timeout, [&]() { return CanGet(); });
+    --get_waiters_;
+    telemetry_.GetWaited(wait_start);
+  }
+  if (container_.empty()) {
+    return false;
+  }
+  PopLocked(result);
+  WakePutters(1);
   return true;
 }
 
-template <class T, class Container>
-void BlockingQueue<T, Container>::Shutdown() {
+template <class T, class Container, class Telemetry>
+template <class Iterator>
+void BlockingQueue<T, Container, Telemetry>::PutBatch(Iterator begin, Iterator end) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (begin != end) {
+    if (!CanPut()) {
+      WaitToPut(lock);
+    }
+    if (is_shutdown_) {
+      throw ShutdownQueueException();
+    }
+    size_t count = 0;
+    for (; begin != end && container_.size() < capacity_; ++begin, ++count) {
+      PushLocked(std::move(*begin));
+    }
+    WakeGetters(count);
+  }
+}
+
+template <class T, class Container, class Telemetry>
+template <class OutputIterator>
+size_t BlockingQueue<T, Container, Telemetry>::GetBatch(OutputIterator out,
+                                                        const size_t max_count) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (max_count == 0) {
+    return 0;
+  }
+  if (!CanGet()) {
+    WaitToGet(lock);
+  }
+  size_t count = 0;
+  for (; count < max_count && !container_.empty(); ++count) {
+    *out++ = std::move(container_.front());
+    container_.pop_front();
+    telemetry_.Dequeued();
+  }
+  WakePutters(count);
+  return count;
+}
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::Shutdown() {
   std::unique_lock<std::mutex> lock(mutex_);
   is_shutdown_ = true;
   cv_put_.notify_all();
   cv_get_.notify_all();
 }
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::WaitToPut(std::unique_lock<std::mutex>& lock) {
+  auto wait_start = telemetry_.StartWait();
+  ++put_waiters_;
+  cv_put_.wait(lock, [&]() { return CanPut(); });
+  --put_waiters_;
+  telemetry_.PutBlocked(wait_start);
+}
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::WaitToGet(std::unique_lock<std::mutex>& lock) {
+  auto wait_start = telemetry_.StartWait();
+  ++get_waiters_;
+  cv_get_.wait(lock, [&]() { return CanGet(); });
+  --get_waiters_;
+  telemetry_.GetWaited(wait_start);
+}
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::PushLocked(T &&element) {
+  container_.push_back(std::move(element));
+  telemetry_.Enqueued(container_.size());
+}
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::PopLocked(T &result) {
+  result = std::move(container_.front());
+  container_.pop_front();
+  telemetry_.Dequeued();
+}
+
+// the waiter counters are guarded by mutex_, so a zero count means
+// nobody can be between its predicate check and its wait
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::WakeGetters(const size_t count) {
+  if (get_waiters_ == 0 || count == 0) {
+    return;
+  }
+  if (count == 1) {
+    cv_get_.notify_one();
+  } else {
+    cv_get_.notify_all();
+  }
+}
+
+template <class T, class Container, class Telemetry>
+void BlockingQueue<T, Container, Telemetry>::WakePutters(const size_t count) {
+  if (put_waiters_ == 0 || count == 0) {
+    return;
+  }
+  if (count == 1) {
+    cv_put_.notify_one();
+  } else {
+    cv_put_.notify_all();
+  }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Negative-lookup filter policies for StripedHashSet.
+//
+// NoSetFilter (the default) compiles to nothing.
+// BlockedBloomFilter answers "definitely absent" without any lock: Contains
+// skips the stripe lock when MayContain is false. Insert adds the element's
+// hash under its stripe lock. A Bloom filter cannot forget, so removed
+// elements only raise the false-positive rate; once enough were removed (or
+// the set outgrew the filter) the set rebuilds it under all stripe locks.
+//
+// Rebuild protocol, seqlock style: BeginRebuild makes the version odd,
+// EndRebuild makes it even again. MayContain says "maybe" whenever it
+// overlapped a rebuild, so a reader never trusts a half-built filter and
+// falls back to the locked lookup.
+
+class NoSetFilter {
+ public:
+  bool MayContain(const size_t) const {
+    return true;
+  }
+
+  void Add(const size_t) {}
+  void Removed() {}
+
+  bool NeedsRebuild(const size_t) const {
+    return false;
+  }
+
+  void BeginRebuild(const size_t) {}
+  void EndRebuild() {}
+};
+
+// Putze, Sanders, Singler, "Cache-, Hash- and Space-Efficient Bloom Filters":
+// all bits of an element live in one 64-byte block of 8 words,
+// so a lookup touches one cache line.
+class BlockedBloomFilter {
+ public:
+  static constexpr size_t kWordsPerBlock = 8;
+  static constexpr size_t kBitsPerBlock = kWordsPerBlock * 64;
+
+  explicit BlockedBloomFilter(const size_t expected_elements = 1 << 16,
+                              const size_t bits_per_element = 10)
+      : bits_per_element_(std::max<size_t>(bits_per_element, 1)),
+        num_hashes_(std::clamp<size_t>(
+            static_cast<size_t>(std::lround(bits_per_element_ * 0.693)), 1, 16)),
+        blocks_(NewBlocks(std::max<size_t>(expected_elements, 1))) {}
+
+  ~BlockedBloomFilter() {
+    delete blocks_.load(std::memory_order_relaxed);
+  }
+
+  BlockedBloomFilter(const BlockedBloomFilter&) = delete;
+  BlockedBloomFilter& operator=(const BlockedBloomFilter&) = delete;
+
+  bool MayContain(const size_t hash) const {
+    const uint64_t version = version_.load(std::memory_order_acquire); // (1)
+    if (version & 1) {
+      return true;
+    }
+    const Blocks* blocks = blocks_.load(std::memory_order_acquire);
+    uint64_t mask[kWordsPerBlock];
+    const Block& block = Locate(*blocks, hash, mask);
+
+    uint64_t words[kWordsPerBlock];
+    for (size_t i = 0; i < kWordsPerBlock; ++i) {
+      words[i] = block.words_[i].load(std::memory_order_relaxed);
+    }
+    // branch-free over the whole line, vectorizes
+    uint64_t missing = 0;
+    for (size_t i = 0; i < kWordsPerBlock; ++i) {
+      missing |= mask[i] & ~words[i];
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version_.load(std::memory_order_relaxed) != version) { // pairs with (2)
+      return true;
+    }
+    return missing == 0;
+  }
+
+  // called with the element's stripe locked
+  void Add(const size_t hash) {
+    AddTo(*blocks_.load(std::memory_order_relaxed), hash);
+  }
+
+  void Removed() {
+    removed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // rebuild once removals reach a quarter of the set, or the set has
+  // outgrown the capacity the filter was sized for
+  bool NeedsRebuild(const size_t num_elements) const {
+    const size_t removed = removed_.load(std::memory_order_relaxed);
+    return (removed > 0 && removed >= std::max<size_t>(num_elements / 4, kMinRemovals)) ||
+        num_elements > blocks_.load(std::memory_order_relaxed)->capacity_;
+  }
+
+  // called with every stripe locked, followed by Add for every element
+  void BeginRebuild(const size_t num_elements) {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // (2)
+
+    Blocks* blocks = blocks_.load(std::memory_order_relaxed);
+    if (num_elements > blocks->capacity_) {
+      // readers may still be on the old array: retire it, as the sizes
+      // double the retired arrays sum up to less than the current one
+      retired_.emplace_back(blocks);
+      blocks_.store(NewBlocks(2 * num_elements), std::memory_order_release);
+    } else {
+      for (size_t i = 0; i <= blocks->block_mask_; ++i) {
+        for (auto& word : blocks->blocks_[i].words_) {
+          word.store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+    removed_.store(0, std::memory_order_relaxed);
+  }
+
+  void EndRebuild() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  size_t Capacity() const {
+    return blocks_.load(std::memory_order_acquire)->capacity_;
+  }
+
+ private:
+  struct alignas(64) Block {
+    std::atomic<uint64_t> words_[kWordsPerBlock];
+  };
+
+  struct Blocks {
+    size_t capacity_;
+    size_t block_mask_;
+    std::unique_ptr<Block[]> blocks_;
+  };
+
+  static constexpr size_t kMinRemovals = 1024;
+
+  Blocks* NewBlocks(const size_t capacity) const {
+    size_t num_blocks = 1;
+    while (num_blocks * kBitsPerBlock < capacity * bits_per_element_) {
+      num_blocks *= 2;
+    }
+    // value-initialized: all bits clear
+    return new Blocks{capacity, num_blocks - 1, std::make_unique<Block[]>(num_blocks)};
+  }
+
+  static uint64_t Mix(uint64_t x) {
+    // MurmurHash3 finalizer: std::hash of integers is the identity
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  // picks the block and fills the per-word bit mask of the element
+  Block& Locate(const Blocks& blocks, const size_t hash,
+                uint64_t (&mask)[kWordsPerBlock]) const {
+    const uint64_t mixed = Mix(hash);
+    const uint64_t bits = Mix(mixed ^ 0x9e3779b97f4a7c15ULL);
+    const uint32_t h1 = static_cast<uint32_t>(bits);
+    const uint32_t h2 = static_cast<uint32_t>(bits >> 32) | 1;
+    std::fill(mask, mask + kWordsPerBlock, 0);
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      const uint32_t bit = (h1 + static_cast<uint32_t>(i) * h2) % kBitsPerBlock;
+      mask[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+    return blocks.blocks_[mixed & blocks.block_mask_];
+  }
+
+  void AddTo(Blocks& blocks, const size_t hash) {
+    uint64_t mask[kWordsPerBlock];
+    Block& block = Locate(blocks, hash, mask);
+    for (size_t i = 0; i < kWordsPerBlock; ++i) {
+      if (mask[i]) {
+        block.words_[i].fetch_or(mask[i], std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  size_t bits_per_element_;
+  size_t num_hashes_;
+  alignas(64) std::atomic<uint64_t> version_{0};
+  std::atomic<Blocks*> blocks_;
+  std::atomic<size_t> removed_{0};
+  // touched only during a rebuild, with every stripe locked
+  std::vector<std::unique_ptr<Blocks>> retired_;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Dynamically resizable Chase-Lev work-stealing deque,
+// memory orders follow Le, Pop, Cohen, Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP'13).
+//
+// Push/Pop may be called only by the owner thread (LIFO end),
+// Steal may be called by any thread (FIFO end).
+// Buffers replaced by a resize are retired and freed with the deque:
+// a thief may still be reading from them, and they sum up to less than
+// the current buffer.
+
+template <typename T>
+class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "elements are copied through std::atomic<T>");
+
+  class Buffer {
+   public:
+    explicit Buffer(const size_t log_capacity)
+        : log_capacity_(log_capacity),
+          mask_((size_t{1} << log_capacity) - 1),
+          slots_(new std::atomic<T>[mask_ + 1]) {}
+
+    int64_t Capacity() const {
+      return static_cast<int64_t>(mask_ + 1);
+    }
+
+    T Load(const int64_t index) const {
+      return slots_[index & mask_].load(std::memory_order_relaxed);
+    }
+
+    void Store(const int64_t index, T element) {
+      slots_[index & mask_].store(element, std::memory_order_relaxed);
+    }
+
+    Buffer* Grow(const int64_t top, const int64_t bottom) const {
+      Buffer* grown = new Buffer(log_capacity_ + 1);
+      for (int64_t i = top; i < bottom; ++i) {
+        grown->Store(i, Load(i));
+      }
+      return grown;
+    }
+
+   private:
+    size_t log_capacity_;
+    size_t mask_;
+    std::unique_ptr<std::atomic<T>[]> slots_;
+  };
+
+ public:
+  explicit ChaseLevDeque(const size_t log_capacity = 8)
+      : buffer_(new Buffer(log_capacity)) {}
+
+  ~ChaseLevDeque() {
+    delete buffer_.load(std::memory_order_relaxed);
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  void Push(T element) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top > buffer->Capacity() - 1) {
+      buffer = Resize(buffer, top, bottom);
+    }
+    buffer->Store(bottom, element);
+    std::atomic_thread_fence(std::memory_order_release); // (1)
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  bool Pop(T& element) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst); // (2)
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      // empty
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+    element = buffer->Load(bottom);
+    if (top == bottom) {
+      // last element: race with the thieves for it
+      const bool won = top_.compare_exchange_strong(
+          top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // false if the deque looked empty or another thread took the element first
+  bool Steal(T& element) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst); // (3)
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return false;
+    }
+    Buffer* buffer = buffer_.load(std::memory_order_acquire); // (4)
+    const T stolen = buffer->Load(top);
+    if (!top_.compare_exchange_strong(
+            top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return false;
+    }
+    element = stolen;
+    return true;
+  }
+
+  // approximate when called concurrently with thieves
+  size_t Size() const {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+  }
+
+  bool Empty() const {
+    return Size() == 0;
+  }
+
+ private:
+  Buffer* Resize(Buffer* buffer, const int64_t top, const int64_t bottom) {
+    Buffer* grown = buffer->Grow(top, bottom);
+    retired_.emplace_back(buffer);
+    buffer_.store(grown, std::memory_order_release); // pairs with (4)
+    return grown;
+  }
+
+ private:
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  // touched only by the owner
+  std::vector<std::unique_ptr<Buffer>> retired_;
+};
@@ -0,0 +1,405 @@
+// Runs the structures with an Atomic hook under the schedule checker.
+// Exits non-zero and prints the failing seed on the first broken invariant.
+// With --free-running the same scenarios run on free threads instead, for
+// a -fsanitize=thread build (see RunConcurrently in schedule_checker.h).
+// A scenario shares plain variables between its threads only under the
+// lock it tests.
+//
+//   g++ -O1 -std=c++17 -pthread -I.. structures_check.cpp
+//   ./a.out [schedules] [--free-running]
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arena_allocator.h"
+#include "lock_stats.h"
+#include "schedule_checker.h"
+
+#include "MCS_spinlock.h"
+#include "barrier.h"
+#include "concurrent_priority_queue.h"
+#include "lock_free_queue.h"
+#include "lock_free_stack.h"
+#include "mpsc_mailbox.h"
+#include "robot_n_sem.h"
+#include "seqlock.h"
+#include "spsc_ring_buffer.h"
+#include "tas_spinlock.h"
+
+// the list SpinLock clashes with the MCS checker alias
+namespace optimistic {
+#include "optimistic_list.h"
+}
+
+namespace {
+
+// fails if two threads are ever inside at the same time
+class ExclusionProbe {
+ public:
+  bool Enter() {
+    return inside_.fetch_add(1) == 0;
+  }
+
+  void Leave() {
+    inside_.fetch_sub(1);
+  }
+
+ private:
+  CheckerAtomic<int> inside_{0};
+};
+
+bool CheckLockFreeStack(ScheduleChecker& checker) {
+  LockFreeStack<int, CheckerAtomic> stack;
+  std::vector<int> popped[3];
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&, t]() {
+      stack.Push(2 * t);
+      stack.Push(2 * t + 1);
+      int element = 0;
+      if (stack.Pop(element)) {
+        popped[t].push_back(element);
+      }
+    });
+  }
+  checker.Run();
+
+  std::vector<int> all;
+  for (const auto& part : popped) {
+    all.insert(all.end(), part.begin(), part.end());
+  }
+  int element = 0;
+  while (stack.Pop(element)) {
+    all.push_back(element);
+  }
+  std::sort(all.begin(), all.end());
+  for (int i = 0; i < 6; ++i) {
+    if (static_cast<int>(all.size()) != 6 || all[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// two producers, two consumers; every element is taken exactly once
+// and each producer's elements come out in order
+bool CheckLockFreeQueue(ScheduleChecker& checker) {
+  LockFreeQueue<int, CheckerAtomic> queue;
+  // recycle a few nodes before the run
+  for (int i = 0; i < 3; ++i) {
+    int element = -1;
+    queue.Put(-1);
+    queue.TryGet(element);
+  }
+  std::vector<int> taken[2];
+  for (int t = 0; t < 2; ++t) {
+    checker.Spawn([&, t]() {
+      queue.Put(10 * t);
+      queue.Put(10 * t + 1);
+    });
+    checker.Spawn([&, t]() {
+      for (int i = 0; i < 2; ++i) {
+        int element = 0;
+        if (queue.TryGet(element)) {
+          taken[t].push_back(element);
+        }
+      }
+    });
+  }
+  checker.Run();
+
+  std::vector<int> all;
+  for (const auto& part : taken) {
+    for (size_t i = 1; i < part.size(); ++i) {
+      if (part[i] / 10 == part[i - 1] / 10 && part[i] < part[i - 1]) {
+        return false;
+      }
+    }
+    all.insert(all.end(), part.begin(), part.end());
+  }
+  int element = 0;
+  while (queue.TryGet(element)) {
+    all.push_back(element);
+  }
+  std::sort(all.begin(), all.end());
+  return all == std::vector<int>{0, 1, 10, 11};
+}
+
+struct Letter : BasicMailboxNode<CheckerAtomic> {
+  int payload = 0;
+};
+
+// three producers, one consumer; each producer's letters arrive in order
+bool CheckMPSCMailbox(ScheduleChecker& checker) {
+  MPSCMailbox<Letter, CheckerAtomic> mailbox;
+  Letter letters[3][2];
+  std::vector<int> received;
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&, t]() {
+      for (int i = 0; i < 2; ++i) {
+        letters[t][i].payload = 10 * t + i;
+        mailbox.Push(&letters[t][i]);
+      }
+    });
+  }
+  checker.Spawn([&]() {
+    for (int i = 0; i < 8; ++i) {
+      if (Letter* letter = mailbox.TryPop()) {
+        received.push_back(letter->payload);
+      }
+    }
+  });
+  checker.Run();
+
+  while (Letter* letter = mailbox.TryPop()) {
+    received.push_back(letter->payload);
+  }
+  for (size_t i = 0; i < received.size(); ++i) {
+    for (size_t j = i + 1; j < received.size(); ++j) {
+      if (received[i] / 10 == received[j] / 10 && received[i] > received[j]) {
+        return false;
+      }
+    }
+  }
+  std::sort(received.begin(), received.end());
+  return mailbox.Empty() && received == std::vector<int>{0, 1, 10, 11, 20, 21};
+}
+
+bool CheckMCSSpinLock(ScheduleChecker& checker) {
+  MCSSpinLock<CheckerAtomic> spinlock;
+  ExclusionProbe probe;
+  bool ok = true;
+  int counter = 0;
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&]() {
+      for (int i = 0; i < 2; ++i) {
+        MCSSpinLock<CheckerAtomic>::Guard guard(spinlock);
+        ok = probe.Enter() && ok;
+        ++counter;
+        probe.Leave();
+      }
+    });
+  }
+  checker.Run();
+  return ok && counter == 6;
+}
+
+// Lock and TryLock against each other
+bool CheckTASSpinLock(ScheduleChecker& checker) {
+  BasicTASSpinLock<NoLockStats, CheckerAtomic> spinlock;
+  ExclusionProbe probe;
+  bool ok = true;
+  int counter = 0;
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&, t]() {
+      for (int i = 0; i < 2; ++i) {
+        if (t == 0) {
+          while (!spinlock.TryLock()) {
+            std::this_thread::yield();
+          }
+        } else {
+          spinlock.Lock();
+        }
+        ok = probe.Enter() && ok;
+        ++counter;
+        probe.Leave();
+        spinlock.Unlock();
+      }
+    });
+  }
+  checker.Run();
+  return ok && counter == 6;
+}
+
+// a ring of two slots, so the producer also meets a full buffer;
+// the consumer gets every element once and in order
+bool CheckSPSCRingBuffer(ScheduleChecker& checker) {
+  SPSCRingBuffer<int, NoQueueTelemetry, CheckerAtomic> ring(2);
+  std::vector<int> received;
+  checker.Spawn([&]() {
+    for (int i = 1; i <= 4; ++i) {
+      while (!ring.Publish(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  checker.Spawn([&]() {
+    int element = 0;
+    while (received.size() < 4) {
+      if (ring.Consume(element)) {
+        received.push_back(element);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  checker.Run();
+  int element = 0;
+  return received == std::vector<int>{1, 2, 3, 4} && !ring.Consume(element);
+}
+
+bool CheckOptimisticLinkedSet(ScheduleChecker& checker) {
+  ArenaAllocator allocator;
+  optimistic::OptimisticLinkedSet<int, CheckerAtomic> set(allocator);
+  set.Insert(2);
+  bool inserted[2] = {false, false};
+  bool removed = false;
+  bool removed_inserted = false;
+  // a Remove of 1 is never counted before its Insert
+  bool size_in_range = true;
+  checker.Spawn([&]() { inserted[0] = set.Insert(1); });
+  checker.Spawn([&]() { inserted[1] = set.Insert(1); });
+  checker.Spawn([&]() {
+    removed_inserted = set.Remove(1);
+    size_in_range = set.Size() <= 2;
+    removed = set.Remove(2);
+  });
+  checker.Run();
+  // both Inserts succeed when the Remove lands between them
+  const int ones = inserted[0] + inserted[1] - removed_inserted;
+  return (ones == 0 || ones == 1) && removed && size_in_range &&
+      set.Contains(1) == (ones == 1) && !set.Contains(2) &&
+      set.Size() == static_cast<size_t>(ones) && set.ApproximateSize() == set.Size();
+}
+
+bool CheckSkipListPriorityQueue(ScheduleChecker& checker) {
+  ArenaAllocator allocator;
+  SkipListPriorityQueue<int, CheckerAtomic> queue(allocator);
+  queue.Push(5);
+  // every thread pops once, pushers push first
+  int popped_by[3] = {0, 0, 0};
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&, t]() {
+      if (t < 2) {
+        queue.Push(t == 0 ? 3 : 7);
+      }
+      queue.TryPop(popped_by[t]);
+    });
+  }
+  checker.Run();
+
+  std::vector<int> popped;
+  for (const int element : popped_by) {
+    if (element != 0) {
+      popped.push_back(element);
+    }
+  }
+
+  // quiescent: the rest comes out in order
+  std::vector<int> rest;
+  int element;
+  while (queue.TryPop(element)) {
+    rest.push_back(element);
+  }
+  if (!std::is_sorted(rest.begin(), rest.end())) {
+    return false;
+  }
+  popped.insert(popped.end(), rest.begin(), rest.end());
+  std::sort(popped.begin(), popped.end());
+  return popped == std::vector<int>{3, 5, 7};
+}
+
+bool CheckSeqLock(ScheduleChecker& checker) {
+  struct Pair {
+    uint64_t first = 0;
+    uint64_t second = 0;
+  };
+  BasicSeqLock<Pair, NoWriterLock, CheckerAtomic> seqlock;
+  bool ok[2] = {true, true};
+  checker.Spawn([&]() {
+    for (uint64_t i = 1; i <= 2; ++i) {
+      seqlock.Store(Pair{i, i});
+    }
+  });
+  for (int t = 0; t < 2; ++t) {
+    checker.Spawn([&, t]() {
+      for (int i = 0; i < 2; ++i) {
+        const Pair pair = seqlock.Load();
+        ok[t] = pair.first == pair.second && ok[t];
+      }
+    });
+  }
+  checker.Run();
+  return ok[0] && ok[1] && seqlock.Load().first == 2 && seqlock.Version() == 4;
+}
+
+bool CheckCyclicBarrier(ScheduleChecker& checker) {
+  constexpr int kThreads = 3;
+  constexpr int kRounds = 2;
+  CyclicBarrier<CheckerConditionVariable, CheckerMutex> barrier(kThreads);
+  CheckerAtomic<int> arrived[kRounds];
+  bool ok[kThreads] = {true, true, true};
+  for (int t = 0; t < kThreads; ++t) {
+    checker.Spawn([&, t]() {
+      for (int round = 0; round < kRounds; ++round) {
+        arrived[round].fetch_add(1);
+        barrier.Pass();
+        ok[t] = arrived[round].load() == kThreads && ok[t];
+      }
+    });
+  }
+  checker.Run();
+  return std::all_of(std::begin(ok), std::end(ok), [](const bool passed) { return passed; });
+}
+
+bool CheckSemaphore(ScheduleChecker& checker) {
+  BasicSemaphore<CheckerMutex, CheckerConditionVariable> semaphore(1);
+  ExclusionProbe probe;
+  bool ok = true;
+  for (int t = 0; t < 3; ++t) {
+    checker.Spawn([&]() {
+      semaphore.wait();
+      ok = probe.Enter() && ok;
+      probe.Leave();
+      semaphore.signal();
+    });
+  }
+  checker.Run();
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t schedules = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+  const bool free_running = argc > 2 && std::string(argv[2]) == "--free-running";
+
+  struct Check {
+    const char* name;
+    bool (*run)(ScheduleChecker&);
+  };
+  const Check checks[] = {
+      {"LockFreeStack", &CheckLockFreeStack},
+      {"LockFreeQueue", &CheckLockFreeQueue},
+      {"MPSCMailbox", &CheckMPSCMailbox},
+      {"MCSSpinLock", &CheckMCSSpinLock},
+      {"TASSpinLock", &CheckTASSpinLock},
+      {"SPSCRingBuffer", &CheckSPSCRingBuffer},
+      {"OptimisticLinkedSet", &CheckOptimisticLinkedSet},
+      {"SkipListPriorityQueue", &CheckSkipListPriorityQueue},
+      {"SeqLock", &CheckSeqLock},
+      {"CyclicBarrier", &CheckCyclicBarrier},
+      {"Semaphore", &CheckSemaphore},
+  };
+
+  for (const Check& check : checks) {
+    const bool ok = free_running ? RunConcurrently(schedules, check.run)
+                                 : ExploreSchedules(schedules, check.run);
+    if (!ok) {
+      std::cerr << check.name << ": FAILED" << std::endl;
+      return 1;
+    }
+    std::cout << check.name << ": " << schedules
+              << (free_running ? " free runs ok" : " schedules ok") << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include "arena_allocator.h"
+#include "element_traits.h"
+#include "tas_spinlock.h"
+#include "thread_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Concurrent min-priority queues: Push(element), TryPop(out) takes the
+// smallest element by operator<.
+//
+// SkipListPriorityQueue is the exact one: a lock-free skip list
+// (Herlihy, Shavit, "The Art of Multiprocessor Programming", SkipQueue).
+// TryPop claims the first unclaimed node of the bottom level, then unlinks
+// it. It is quiescently consistent: an element pushed concurrently with a
+// TryPop may be passed over in favour of a larger one.
+//
+// MultiQueue is the relaxed one (Rihani, Sanders, Dementiev, "MultiQueues:
+// Simple Relaxed Concurrent Priority Queues"): c x threads sequential heaps
+// behind TAS spinlocks. Push goes to a random heap, TryPop pops the better
+// top of two random heaps. The popped element is expected to rank O(c x
+// threads) rather than first, in exchange for near-independent threads.
+
+// xorshift64*, one stream per thread
+inline uint64_t ThreadLocalRandom() {
+  static thread_local uint64_t state = 0x9e3779b97f4a7c15ULL * (ThisThreadIndex() + 1);
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+
+// Nodes are never freed individually, they live as long as the allocator.
+// Duplicates are allowed; a new element goes in front of its equals.
+template <typename T, template <typename U> class Atomic = std::atomic>
+class SkipListPriorityQueue {
+ public:
+  static constexpr size_t kMaxLevel = 24;
+
+ private:
+  // the low bit of a next_ word marks its node as removed at that level
+  struct Node {
+    T element_;
+    size_t top_level_;
+    Atomic<bool> claimed_{false};
+    Atomic<uintptr_t> next_[kMaxLevel];
+
+    Node(const T& element, const size_t top_level) : element_(element), top_level_(top_level) {}
+  };
+
+  static_assert(alignof(Node) >= 2, "the mark bit needs aligned nodes");
+
+ public:
+  explicit SkipListPriorityQueue(ArenaAllocator& allocator)
+      : allocator_(allocator) {
+    CreateEmptyList();
+  }
+
+  void Push(const T& element) {
+    const size_t top_level = RandomLevel();
+    Node* preds[kMaxLevel];
+    Node* succs[kMaxLevel];
+    Node* node = allocator_.New<Node>(element, top_level);
+    while (true) {
+      Find(element, preds, succs);
+      for (size_t level = 0; level < top_level; ++level) {
+        node->next_[level].store(Word(succs[level]), std::memory_order_relaxed);
+      }
+      uintptr_t expected = Word(succs[0]);
+      // (1) publishes the initialized node
+      if (preds[0]->next_[0].compare_exchange_strong(expected, Word(node),
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    // the bottom level decides membership, upper levels are only shortcuts
+    for (size_t level = 1; level < top_level; ++level) {
+      while (true) {
+        uintptr_t expected = Word(succs[level]);
+        if (preds[level]->next_[level].compare_exchange_strong(expected, Word(node),
+                                                               std::memory_order_release,
+                                                               std::memory_order_relaxed)) {
+          break;
+        }
+        Find(element, preds, succs);
+        // redirect our link, unless a TryPop already marked it
+        uintptr_t link = node->next_[level].load(std::memory_order_relaxed);
+        if (IsMarked(link) ||
+            !node->next_[level].compare_exchange_strong(link, Word(succs[level]),
+                                                        std::memory_order_relaxed)) {
+          return;
+        }
+      }
+    }
+  }
+
+  bool TryPop(T& ret_value) {
+    Node* curr = Ptr(head_->next_[0].load(std::memory_order_acquire)); // pairs with (1)
+    while (curr != tail_) {
+      if (!curr->claimed_.load(std::memory_order_relaxed) &&
+          !curr->claimed_.exchange(true, std::memory_order_acquire)) {
+        ret_value = curr->element_;
+        Unlink(curr);
+        return true;
+      }
+      curr = Ptr(curr->next_[0].load(std::memory_order_acquire));
+    }
+    return false;
+  }
+
+ private:
+  static uintptr_t Word(Node* node) {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+
+  static Node* Ptr(const uintptr_t word) {
+    return reinterpret_cast<Node*>(word & ~uintptr_t{1});
+  }
+
+  static bool IsMarked(const uintptr_t word) {
+    return word & 1;
+  }
+
+  static size_t RandomLevel() {
+    // geometric with p = 1/2
+    const uint64_t bits = ThreadLocalRandom() | (uint64_t{1} << (kMaxLevel - 1));
+    return static_cast<size_t>(__builtin_ctzll(bits)) + 1;
+  }
+
+  void CreateEmptyList() {
+    head_ = allocator_.New<Node>(ElementTraits<T>::Min(), kMaxLevel);
+    tail_ = allocator_.New<Node>(ElementTraits<T>::Max(), kMaxLevel);
+    for (size_t level = 0; level < kMaxLevel; ++level) {
+      head_->next_[level].store(Word(tail_), std::memory_order_relaxed);
+      tail_->next_[level].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // only the claiming thread unlinks a node: marks it top down, then snips
+  // it out of every level. Find stops at the first equal element, which may
+  // be a live duplicate in front of the node, so the snip goes on from
+  // there through the equals until it meets the node itself.
+  void Unlink(Node* node) {
+    for (size_t level = node->top_level_; level-- > 0;) {
+      uintptr_t link = node->next_[level].load(std::memory_order_relaxed);
+      while (!IsMarked(link) &&
+             !node->next_[level].compare_exchange_weak(link, link | 1,
+                                                       std::memory_order_relaxed)) {
+      }
+    }
+    Node* preds[kMaxLevel];
+    Node* succs[kMaxLevel];
+    do {
+      Find(node->element_, preds, succs);
+    } while (!TrySnip(node, preds));
+  }
+
+  // false if a snip lost a race and the preds have to be found again
+  bool TrySnip(Node* node, Node** preds) {
+    for (size_t level = node->top_level_; level-- > 0;) {
+      Node* pred = preds[level];
+      Node* curr = Ptr(pred->next_[level].load(std::memory_order_acquire));
+      // past the equals the node is already gone from this level
+      while (curr != tail_ && !(node->element_ < curr->element_)) {
+        const uintptr_t succ = curr->next_[level].load(std::memory_order_acquire);
+        if (!IsMarked(succ)) {
+          pred = curr;
+        } else {
+          uintptr_t expected = Word(curr);
+          if (!pred->next_[level].compare_exchange_strong(expected, Word(Ptr(succ)),
+                                                          std::memory_order_release,
+                                                          std::memory_order_relaxed)) {
+            return false;
+          }
+          if (curr == node) {
+            break;
+          }
+        }
+        curr = Ptr(succ);
+      }
+    }
+    return true;
+  }
+
+  // fills pred < element <= succ on every level, snipping marked nodes
+  void Find(const T& element, Node** preds, Node** succs) {
+    while (!TryFind(element, preds, succs)) {
+    }
+  }
+
+  bool TryFind(const T& element, Node** preds, Node** succs) {
+    Node* pred = head_;
+    for (size_t level = kMaxLevel; level-- > 0;) {
+      Node* curr = Ptr(pred->next_[level].load(std::memory_order_acquire));
+      while (true) {
+        uintptr_t succ = curr->next_[level].load(std::memory_order_acquire);
+        while (IsMarked(succ)) {
+          uintptr_t expected = Word(curr);
+          if (!pred->next_[level].compare_exchange_strong(expected, Word(Ptr(succ)),
+                                                          std::memory_order_release,
+                                                          std::memory_order_relaxed)) {
+            return false;
+          }
+          curr = Ptr(succ);
+          succ = curr->next_[level].load(std::memory_order_acquire);
+        }
+        if (curr != tail_ && curr->element_ < element) {
+          pred = curr;
+          curr = Ptr(succ);
+        } else {
+          break;
+        }
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return true;
+  }
+
+ private:
+  ArenaAllocator& allocator_;
+  Node* head_{nullptr};
+  Node* tail_{nullptr};
+};
+
+template <typename T>
+class MultiQueue {
+ public:
+  explicit MultiQueue(const size_t num_threads = std::thread::hardware_concurrency(),
+                      const size_t heaps_per_thread = 2)
+      : num_heaps_(std::max<size_t>(2, std::max<size_t>(num_threads, 1) * heaps_per_thread)),
+        heaps_(new Heap[num_heaps_]) {}
+
+  void Push(const T& element) {
+    Heap& heap = LockRandomHeap();
+    heap.heap_.push(element);
+    heap.lock_.Unlock();
+  }
+
+  bool TryPop(T& ret_value) {
+    while (true) {
+      const size_t first = ThreadLocalRandom() % num_heaps_;
+      const size_t second = (first + 1 + ThreadLocalRandom() % (num_heaps_ - 1)) % num_heaps_;
+      if (!heaps_[first].lock_.TryLock()) {
+        continue;
+      }
+      if (!heaps_[second].lock_.TryLock()) {
+        heaps_[first].lock_.Unlock();
+        continue;
+      }
+      Heap* best = Better(heaps_[first], heaps_[second]);
+      if (best != nullptr) {
+        ret_value = best->heap_.top();
+        best->heap_.pop();
+      }
+      heaps_[first].lock_.Unlock();
+      heaps_[second].lock_.Unlock();
+      if (best != nullptr) {
+        return true;
+      }
+      // both picks were empty, the others may not be
+      return PopFromAny(ret_value);
+    }
+  }
+
+  size_t NumHeaps() const {
+    return num_heaps_;
+  }
+
+ private:
+  struct alignas(64) Heap {
+    TASSpinLock lock_;
+    std::priority_queue<T, std::vector<T>, std::greater<T>> heap_;
+  };
+
+  Heap& LockRandomHeap() {
+    while (true) {
+      Heap& heap = heaps_[ThreadLocalRandom() % num_heaps_];
+      if (heap.lock_.TryLock()) {
+        return heap;
+      }
+    }
+  }
+
+  static Heap* Better(Heap& first, Heap& second) {
+    if (first.heap_.empty()) {
+      return second.heap_.empty() ? nullptr : &second;
+    }
+    if (second.heap_.empty()) {
+      return &first;
+    }
+    return second.heap_.top() < first.heap_.top() ? &second : &first;
+  }
+
+  bool PopFromAny(T& ret_value) {
+    const size_t start = ThreadLocalRandom() % num_heaps_;
+    for (size_t i = 0; i < num_heaps_; ++i) {
+      Heap& heap = heaps_[(start + i) % num_heaps_];
+      heap.lock_.Lock();
+      if (!heap.heap_.empty()) {
+        ret_value = heap.heap_.top();
+        heap.heap_.pop();
+        heap.lock_.Unlock();
+        return true;
+      }
+      heap.lock_.Unlock();
+    }
+    return false;
+  }
+
+ private:
+  const size_t num_heaps_;
+  std::unique_ptr<Heap[]> heaps_;
+};
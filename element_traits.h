@@ -0,0 +1,16 @@
+#pragma once
+
+#include <limits>
+
+// Sentinel keys of the ordered structures: the head node holds Min(),
+// the tail node Max(), and every element must lie strictly between.
+// Specialize for element types without numeric_limits.
+template <typename T>
+struct ElementTraits {
+  static T Min() {
+    return std::numeric_limits<T>::min();
+  }
+  static T Max() {
+    return std::numeric_limits<T>::max();
+  }
+};
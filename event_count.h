@@ -0,0 +1,61 @@
+#pragma once
+
+#include "futex.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Eventcount: lets a thread sleep until "something might have changed"
+// without the notifier taking a lock or a syscall when nobody sleeps.
+//
+// Waiter:
+//   auto key = event_count.PrepareWait();
+//   if (condition) { event_count.CancelWait(); } else { event_count.CommitWait(key); }
+// Notifier:
+//   make condition true; event_count.NotifyOne();
+
+class EventCount {
+ public:
+  using Key = uint32_t;
+
+  Key PrepareWait() {
+    waiters_.fetch_add(1); // (1)
+    return epoch_.load();
+  }
+
+  void CancelWait() {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void CommitWait(const Key key) {
+    while (epoch_.load(std::memory_order_acquire) == key) {
+      FutexWait(epoch_, key);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void NotifyOne() {
+    if (HasWaiters()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      FutexWakeOne(epoch_);
+    }
+  }
+
+  void NotifyAll() {
+    if (HasWaiters()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      FutexWakeAll(epoch_);
+    }
+  }
+
+ private:
+  bool HasWaiters() {
+    // pairs with (1): either we see the waiter or it sees our condition
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return waiters_.load(std::memory_order_relaxed) > 0;
+  }
+
+ private:
+  alignas(64) std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+};
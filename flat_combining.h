@@ -0,0 +1,219 @@
+#pragma once
+
+#include "spin_wait.h"
+#include "thread_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Flat combining, Hendler, Incze, Shavit, Tzafrir,
+// "Flat Combining and the Synchronization-Parallelism Tradeoff" (SPAA'10).
+//
+// A thread publishes its operation in its own cache-line-padded record and
+// spins on it; whoever holds the combiner lock applies every pending
+// operation to the sequential Structure in one pass. Under high contention
+// the structure stays in one core's cache and the lock changes hands once
+// per batch instead of once per operation.
+//
+//   FlatCombiner<std::priority_queue<int>> heap;
+//   heap.Execute([](auto& queue) { queue.push(42); });
+//   int top = heap.Execute([](auto& queue) { int x = queue.top(); queue.pop(); return x; });
+//
+// Operations run on the combiner's thread and must not throw. Threads with
+// ThisThreadIndex() >= max_threads take the combiner lock themselves.
+
+template <class Structure>
+class FlatCombiner {
+ public:
+  template <class... Args>
+  explicit FlatCombiner(const size_t max_threads, Args&&... args)
+      : structure_(std::forward<Args>(args)...),
+        records_(new Record[max_threads]),
+        max_threads_(max_threads) {}
+
+  FlatCombiner() : FlatCombiner(kDefaultMaxThreads) {}
+
+  FlatCombiner(const FlatCombiner&) = delete;
+  FlatCombiner& operator=(const FlatCombiner&) = delete;
+
+  // fn(Structure&) is applied exactly once, its result is returned
+  template <class F>
+  std::invoke_result_t<F&, Structure&> Execute(F&& fn) {
+    using Result = std::invoke_result_t<F&, Structure&>;
+    if constexpr (std::is_void_v<Result>) {
+      Submit(&ApplyVoid<std::remove_reference_t<F>>, &fn);
+    } else {
+      Call<std::remove_reference_t<F>, Result> call{&fn, std::nullopt};
+      Submit(&ApplyValue<std::remove_reference_t<F>, Result>, &call);
+      return std::move(*call.result_);
+    }
+  }
+
+  static constexpr size_t kDefaultMaxThreads = 128;
+
+ private:
+  using Apply = void (*)(Structure&, void*);
+
+  enum : uint32_t {
+    kIdle = 0,
+    kPending = 1,
+    kDone = 2,
+  };
+
+  struct alignas(64) Record {
+    std::atomic<uint32_t> state_{kIdle};
+    // written by the owner before (1), read by the combiner after (2)
+    Apply apply_ = nullptr;
+    void* context_ = nullptr;
+  };
+
+  template <class F, class Result>
+  struct Call {
+    F* fn_;
+    std::optional<Result> result_;
+  };
+
+  template <class F>
+  static void ApplyVoid(Structure& structure, void* context) {
+    (*static_cast<F*>(context))(structure);
+  }
+
+  template <class F, class Result>
+  static void ApplyValue(Structure& structure, void* context) {
+    auto* call = static_cast<Call<F, Result>*>(context);
+    call->result_.emplace((*call->fn_)(structure));
+  }
+
+  void Submit(const Apply apply, void* context) {
+    const size_t index = ThisThreadIndex();
+    if (index >= max_threads_) {
+      Lock();
+      apply(structure_, context);
+      Unlock();
+      return;
+    }
+
+    Record& record = records_[index];
+    record.apply_ = apply;
+    record.context_ = context;
+    record.state_.store(kPending, std::memory_order_release); // (1)
+
+    SpinWait spin_wait;
+    while (record.state_.load(std::memory_order_acquire) != kDone) { // (4)
+      if (TryLock()) {
+        Combine();
+        Unlock();
+        // our record was pending before we became the combiner
+        break;
+      }
+      if (!spin_wait.SpinOnce()) {
+        std::this_thread::yield();
+      }
+    }
+    record.state_.store(kIdle, std::memory_order_relaxed);
+  }
+
+  void Combine() {
+    const size_t end = std::min(ThreadIndexHighWater(), max_threads_);
+    // a second pass catches requests published during the first one
+    for (size_t pass = 0; pass < kCombinePasses; ++pass) {
+      for (size_t i = 0; i < end; ++i) {
+        Record& record = records_[i];
+        if (record.state_.load(std::memory_order_acquire) == kPending) { // (2)
+          record.apply_(structure_, record.context_);
+          record.state_.store(kDone, std::memory_order_release); // (3) pairs with (4)
+        }
+      }
+    }
+  }
+
+  bool TryLock() {
+    return !locked_.load(std::memory_order_relaxed) &&
+        !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void Lock() {
+    SpinWait spin_wait;
+    while (!TryLock()) {
+      if (!spin_wait.SpinOnce()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void Unlock() {
+    locked_.store(false, std::memory_order_release);
+  }
+
+  static constexpr size_t kCombinePasses = 2;
+
+ private:
+  alignas(64) std::atomic<bool> locked_{false};
+  alignas(64) Structure structure_;
+  std::unique_ptr<Record[]> records_;
+  size_t max_threads_;
+};
+
+// Flat-combined stack with the LockFreeStack interface
+
+template <typename T>
+class FlatCombiningStack {
+ public:
+  void Push(T element) {
+    combiner_.Execute([&](std::vector<T>& stack) { stack.push_back(std::move(element)); });
+  }
+
+  bool Pop(T &ret_value) {
+    return combiner_.Execute([&](std::vector<T>& stack) {
+      if (stack.empty()) {
+        return false;
+      }
+      ret_value = std::move(stack.back());
+      stack.pop_back();
+      return true;
+    });
+  }
+
+ private:
+  FlatCombiner<std::vector<T>> combiner_;
+};
+
+// Flat-combined set with the StripedHashSet interface;
+// concurrency_level is the expected number of threads here, not stripes
+
+template <class T, class Hash = std::hash<T>>
+class FlatCombiningSet {
+ public:
+  explicit FlatCombiningSet(const size_t concurrency_level = FlatCombiner<int>::kDefaultMaxThreads)
+      : combiner_(std::max(concurrency_level, FlatCombiner<int>::kDefaultMaxThreads)) {}
+
+  bool Insert(const T& element) {
+    return combiner_.Execute([&](Set& set) { return set.insert(element).second; });
+  }
+
+  bool Remove(const T& element) {
+    return combiner_.Execute([&](Set& set) { return set.erase(element) > 0; });
+  }
+
+  bool Contains(const T& element) {
+    return combiner_.Execute([&](Set& set) { return set.count(element) > 0; });
+  }
+
+  size_t Size() {
+    return combiner_.Execute([](Set& set) { return set.size(); });
+  }
+
+ private:
+  using Set = std::unordered_set<T, Hash>;
+
+  FlatCombiner<Set> combiner_;
+};
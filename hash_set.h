@@ -1,5 +1,8 @@
 #pragma once
 
+#include "bloom_filter.h"
+#include "lock_stats.h"
+
 #include <algorithm>
 #include <atomic>
 #include <condition_variable>
@@ -8,29 +11,37 @@
 #include <mutex>
 #include <vector>
 
-class RWLock {
+template <class Stats = NoLockStats>
+class BasicRWLock {
  public:
-  RWLock(): rlock_(0), wlock_(0), in_writing_(false) {}
+  BasicRWLock(): rlock_(0), wlock_(0), in_writing_(false) {}
 
   void write_lock() {
+    auto probe = stats_.BeginAcquire();
     std::unique_lock<std::mutex> lock(_mutex);
     ++wlock_;
     while (in_writing_ || rlock_ > 0) {
+      probe.Spin();
       lock_cv_.wait(lock);
     }
     in_writing_ = true;
+    stats_.EndAcquire(probe);
   }
 
   void read_lock() {
+    auto probe = stats_.BeginAcquire();
     std::unique_lock<std::mutex> lock(_mutex);
     while (wlock_ > 0) {
+      probe.Spin();
       lock_cv_.wait(lock);
     }
     ++rlock_;
+    stats_.EndAcquireShared(probe);
   }
 
   void write_unlock() {
     std::unique_lock<std::mutex> lock(_mutex);
+    stats_.Release();
     in_writing_ = false;
     --wlock_;
     lock.unlock();
@@ -45,15 +56,23 @@ class RWLock {
     }
   }
 
+  Stats& GetStats() {
+    return stats_;
+  }
+
  private:
   int rlock_;
   int wlock_;
   bool in_writing_;
   std::mutex _mutex;
   std::condition_variable lock_cv_;
+  [[no_unique_address]] Stats stats_;
 };
 
-template <class T, class Hash = std::hash<T>>
+using RWLock = BasicRWLock<>;
+
+// Filter: NoSetFilter or BlockedBloomFilter, see bloom_filter.h
+template <class T, class Hash = std::hash<T>, class Filter = NoSetFilter>
 class StripedHashSet {
  public:
   StripedHashSet(const size_t concurrency_level,
@@ -62,34 +81,81 @@ class StripedHashSet {
   bool Insert(const T& element);
   bool Remove(const T& element);
   bool Contains(const T& element);
-  size_t Size() { return size_; };
+  // exact, takes every stripe lock
+  size_t Size();
+  // lock-free sum of the stripe counts, may miss concurrent updates
+  size_t ApproximateSize() const;
+  Filter& GetFilter() { return filter_; }
 
  private:
   bool check_for_elem(const T& element);
   size_t getBucketIndex(const size_t element_hash_value) { return element_hash_value % container_.size(); };
   size_t getStripeIndex(const size_t element_hash_value) { return element_hash_value % locks_.size(); };
-  void rehash();
+  // written under its stripe's write lock, a line per stripe
+  struct alignas(64) StripeSize {
+    std::atomic<size_t> count_{0};
+    size_t hints_to_skip_ = 0;
+  };
+
+  // A stripe's count scaled up by locks_.size() is only a hint for the
+  // total: with skewed keys it is far too high in heavy stripes. It gates the
+  // lock-free sum, which decides. A light stripe may miss a growth its own
+  // buckets do not need yet; removals still reach the filter through the
+  // stripes at or below the average, whose hint never overestimates.
+  bool overloaded(StripeSize& stripe_size, const size_t stripe_count) {
+    return stripe_count * locks_.size() > max_load_factor_ * container_.size() &&
+        confirm_hint(stripe_size, stripe_count, [this](const size_t size) {
+          return max_load_factor_ < size / container_.size();
+        });
+  }
+  bool filter_needs_rebuild(StripeSize& stripe_size, const size_t stripe_count) {
+    return filter_.NeedsRebuild(stripe_count * locks_.size()) &&
+        confirm_hint(stripe_size, stripe_count, [this](const size_t size) {
+          return filter_.NeedsRebuild(size);
+        });
+  }
+  // a heavy stripe's hint stays on: after a sum that said no, skip the next
+  // stripe_count / kHintBackoff hints, so a check is late by a few percent
+  // of the set at most instead of summing every stripe on every update
+  template <class Check>
+  bool confirm_hint(StripeSize& stripe_size, const size_t stripe_count, Check check) {
+    if (stripe_size.hints_to_skip_ > 0) {
+      --stripe_size.hints_to_skip_;
+      return false;
+    }
+    if (check(ApproximateSize())) {
+      return true;
+    }
+    stripe_size.hints_to_skip_ = stripe_count / kHintBackoff;
+    return false;
+  }
+  void rehash(const size_t observed_bucket_count);
+  void rebuild_filter();
+
+  static constexpr size_t kHintBackoff = 16;
+
   double growth_factor_;
   double max_load_factor_;
-  std::atomic<size_t> size_;
   std::vector<std::forward_list<T>> container_;
   std::vector<RWLock> locks_;
+  std::vector<StripeSize> stripe_sizes_;
   Hash hash;
+  [[no_unique_address]] Filter filter_;
 };
 
-template <class T, class Hash>
-StripedHashSet<T, Hash>::StripedHashSet(const size_t concurrency_level,
-                                        const double _growthFactor,
-                                        const double _maxLoadFactor)
+template <class T, class Hash, class Filter>
+StripedHashSet<T, Hash, Filter>::StripedHashSet(const size_t concurrency_level,
+                                                const double _growthFactor,
+                                                const double _maxLoadFactor)
     : growth_factor_(_growthFactor),
-      max_load_factor_(_maxLoadFactor),
-      size_(0) {
+      max_load_factor_(_maxLoadFactor) {
   locks_ = std::vector<RWLock>(concurrency_level);
+  stripe_sizes_ = std::vector<StripeSize>(concurrency_level);
   container_ = std::vector<std::forward_list<T>>(concurrency_level);
 }
 
-template <class T, class Hash>
-bool StripedHashSet<T, Hash>::Insert(const T& element) {
+template <class T, class Hash, class Filter>
+bool StripedHashSet<T, Hash, Filter>::Insert(const T& element) {
   const size_t element_hash_value = hash(element);
   const size_t stripe_index = getStripeIndex(element_hash_value);
   locks_[stripe_index].write_lock();
@@ -98,19 +164,27 @@ bool StripedHashSet<T, Hash>::Insert(const T& element) {
     locks_[stripe_index].write_unlock();
     return false;
   }
-  if (max_load_factor_ < size_ / container_.size()) {
+  StripeSize& stripe_size = stripe_sizes_[stripe_index];
+  const size_t count = stripe_size.count_.load(std::memory_order_relaxed);
+  if (overloaded(stripe_size, count)) {
+    const size_t bucket_count = container_.size();
     locks_[stripe_index].write_unlock();
-    rehash();
+    rehash(bucket_count);
     return Insert(element);
   }
+  filter_.Add(element_hash_value);
   container_[bucket_index].push_front(element);
-  ++size_;
+  stripe_size.count_.store(count + 1, std::memory_order_relaxed);
+  const bool rebuild = filter_needs_rebuild(stripe_size, count + 1);
   locks_[stripe_index].write_unlock();
+  if (rebuild) {
+    rebuild_filter();
+  }
   return true;
 };
 
-template <class T, class Hash>
-bool StripedHashSet<T, Hash>::Remove(const T& element) {
+template <class T, class Hash, class Filter>
+bool StripedHashSet<T, Hash, Filter>::Remove(const T& element) {
   const size_t element_hash_value = hash(element);
   const size_t stripe_index = getStripeIndex(element_hash_value);
   locks_[stripe_index].write_lock();
@@ -120,14 +194,24 @@ bool StripedHashSet<T, Hash>::Remove(const T& element) {
     return false;
   }
   container_[bucket_index].remove(element);
-  --size_;
+  StripeSize& stripe_size = stripe_sizes_[stripe_index];
+  const size_t count = stripe_size.count_.load(std::memory_order_relaxed) - 1;
+  stripe_size.count_.store(count, std::memory_order_relaxed);
+  filter_.Removed();
+  const bool rebuild = filter_needs_rebuild(stripe_size, count);
   locks_[stripe_index].write_unlock();
+  if (rebuild) {
+    rebuild_filter();
+  }
   return true;
 };
 
-template <class T, class Hash>
-bool StripedHashSet<T, Hash>::Contains(const T& element) {
+template <class T, class Hash, class Filter>
+bool StripedHashSet<T, Hash, Filter>::Contains(const T& element) {
   const size_t element_hash_value = hash(element);
+  if (!filter_.MayContain(element_hash_value)) {
+    return false;
+  }
   const size_t stripe_index = getStripeIndex(element_hash_value);
   locks_[stripe_index].read_lock();
   bool result = check_for_elem(element);
@@ -135,19 +219,48 @@ bool StripedHashSet<T, Hash>::Contains(const T& element) {
   return result;
 }
 
-template <class T, class Hash>
-bool StripedHashSet<T, Hash>::check_for_elem(const T& element) {
+template <class T, class Hash, class Filter>
+bool StripedHashSet<T, Hash, Filter>::check_for_elem(const T& element) {
   const size_t element_hash_value = hash(element);
   const size_t bucket_index = getBucketIndex(element_hash_value);
   return std::find(container_[bucket_index].begin(), container_[bucket_index].end(), element)
       != container_[bucket_index].end();
 }
 
-template <class T, class Hash>
-void StripedHashSet<T, Hash>::rehash() {
+template <class T, class Hash, class Filter>
+size_t StripedHashSet<T, Hash, Filter>::Size() {
+  for (auto &lock : locks_) {
+    lock.read_lock();
+  }
+  const size_t size = ApproximateSize();
+  for (auto &lock : locks_) {
+    lock.read_unlock();
+  }
+  return size;
+}
+
+template <class T, class Hash, class Filter>
+size_t StripedHashSet<T, Hash, Filter>::ApproximateSize() const {
+  size_t size = 0;
+  for (auto const &stripe_size : stripe_sizes_) {
+    size += stripe_size.count_.load(std::memory_order_relaxed);
+  }
+  return size;
+}
+
+// threads that saw the same overloaded stripe queue up here, the first one
+// grows the table and the others find the bucket count changed
+template <class T, class Hash, class Filter>
+void StripedHashSet<T, Hash, Filter>::rehash(const size_t observed_bucket_count) {
   for (auto &lock : locks_) {
     lock.write_lock();
   }
+  if (container_.size() != observed_bucket_count) {
+    for (auto &lock : locks_) {
+      lock.write_unlock();
+    }
+    return;
+  }
   const size_t new_size = container_.size() * growth_factor_;
   std::vector <std::forward_list<T>> new_container(new_size);
   for (auto const &bucket : container_) {
@@ -163,4 +276,25 @@ void StripedHashSet<T, Hash>::rehash() {
   }
 }
 
+// several threads may have asked for the same rebuild, the first one does it
+template <class T, class Hash, class Filter>
+void StripedHashSet<T, Hash, Filter>::rebuild_filter() {
+  for (auto &lock : locks_) {
+    lock.write_lock();
+  }
+  const size_t size = ApproximateSize();
+  if (filter_.NeedsRebuild(size)) {
+    filter_.BeginRebuild(size);
+    for (auto const &bucket : container_) {
+      for (auto const &item : bucket) {
+        filter_.Add(hash(item));
+      }
+    }
+    filter_.EndRebuild();
+  }
+  for (auto &lock : locks_) {
+    lock.write_unlock();
+  }
+}
+
 template <typename T> using ConcurrentSet = StripedHashSet<T>;
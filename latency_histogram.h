@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+inline uint64_t MonotonicNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// HDR-style log-linear histogram: every power of two is split into
+// 2^kSubBucketBits linear sub-buckets, so the relative error is below 25%.
+// Values above 2^kMaxValueBits (~68 s in nanoseconds) land in the last bucket.
+// Record is a relaxed increment, Snapshot sums the buckets on read.
+
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 2;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  static constexpr size_t kMaxValueBits = 36;
+  static constexpr size_t kNumBuckets = kSubBuckets * (kMaxValueBits - kSubBucketBits + 1);
+
+  class Snapshot {
+   public:
+    void Add(const LatencyHistogram& histogram) {
+      for (size_t i = 0; i < kNumBuckets; ++i) {
+        counts_[i] += histogram.buckets_[i].load(std::memory_order_relaxed);
+      }
+    }
+
+    uint64_t Count() const {
+      uint64_t total = 0;
+      for (const uint64_t count : counts_) {
+        total += count;
+      }
+      return total;
+    }
+
+    // upper bound of the bucket holding the q-quantile, q in [0, 1]
+    uint64_t Percentile(const double q) const {
+      const uint64_t total = Count();
+      if (total == 0) {
+        return 0;
+      }
+      const uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kNumBuckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+          return BucketUpperBound(i);
+        }
+      }
+      return BucketUpperBound(kNumBuckets - 1);
+    }
+
+    const std::array<uint64_t, kNumBuckets>& Counts() const {
+      return counts_;
+    }
+
+   private:
+    std::array<uint64_t, kNumBuckets> counts_{};
+  };
+
+  void Record(const uint64_t value) {
+    buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static size_t BucketIndex(const uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    const size_t msb = 63 - __builtin_clzll(value);
+    if (msb >= kMaxValueBits) {
+      return kNumBuckets - 1;
+    }
+    const size_t shift = msb - kSubBucketBits;
+    const size_t sub_bucket = static_cast<size_t>(value >> shift) - kSubBuckets;
+    return kSubBuckets + shift * kSubBuckets + sub_bucket;
+  }
+
+  static uint64_t BucketUpperBound(const size_t index) {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    const size_t shift = (index - kSubBuckets) / kSubBuckets;
+    const uint64_t sub_bucket = (index - kSubBuckets) % kSubBuckets;
+    return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "blocking_queue.h"
+#include "event_count.h"
+#include "spin_wait.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Unbounded lock-free MPMC queue, Michael & Scott,
+// "Simple, Fast, and Practical Non-Blocking and Blocking Concurrent Queue
+// Algorithms" (PODC'96), with the same Put/Get/Shutdown shape as BlockingQueue.
+//
+// Nodes are type-stable: they live in chunks that double in size and are
+// freed only with the queue, and a dequeued node goes to a free list
+// (a Treiber stack) instead of delete. Links are 32-bit node indices paired
+// with a 32-bit tag bumped on every change, so a stale CAS on head, tail,
+// the free list or a recycled node's next always fails (ABA), and a stale
+// read of a recycled node only returns a value the tag check then discards.
+//
+// A node is recycled after two releases: its value was moved out by the
+// dequeuer that won the head CAS, and it was passed as the dummy by the
+// next one. The value is read only after winning the CAS, so T need not be
+// trivially copyable.
+//
+// Puts racing with Shutdown may or may not be accepted; Get drains the
+// accepted elements before returning false. A Put counts itself in flight
+// before its shutdown check and until its node is linked, and Get does not
+// give up while one is.
+
+template <typename T, template <typename U> class Atomic = std::atomic>
+class LockFreeQueue {
+  static constexpr uint32_t kNull = ~uint32_t{0};
+  static constexpr size_t kFirstChunkLog = 6;
+  static constexpr size_t kMaxChunks = 32 - kFirstChunkLog;
+
+  struct Node {
+    Atomic<uint64_t> next{Pack(kNull, 0)};
+    Atomic<uint32_t> free_next{kNull};
+    Atomic<uint32_t> releases{0};
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* Value() {
+      return std::launder(reinterpret_cast<T*>(storage));
+    }
+  };
+
+ public:
+  LockFreeQueue() {
+    const uint32_t dummy = AllocateNode();
+    // the dummy has no value to consume
+    NodeAt(dummy).releases.store(1, std::memory_order_relaxed);
+    head_.store(Pack(dummy, 0), std::memory_order_relaxed);
+    tail_.store(Pack(dummy, 0), std::memory_order_relaxed);
+  }
+
+  ~LockFreeQueue();
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+  void Put(T &&element);
+  // blocks while the queue is empty, false once it is empty and shut down
+  bool Get(T &result);
+  bool TryGet(T &result);
+  void Shutdown();
+
+ private:
+  static uint64_t Pack(const uint32_t index, const uint32_t tag) {
+    return (uint64_t{tag} << 32) | index;
+  }
+
+  static uint32_t IndexOf(const uint64_t link) {
+    return static_cast<uint32_t>(link);
+  }
+
+  static uint32_t TagOf(const uint64_t link) {
+    return static_cast<uint32_t>(link >> 32);
+  }
+
+  Node& NodeAt(const uint32_t index) const;
+  uint32_t AllocateNode();
+  uint32_t AllocateFreshNode();
+  void ReleaseNode(uint32_t index);
+  void PutDone();
+
+ private:
+  alignas(64) Atomic<uint64_t> head_{0};
+  alignas(64) Atomic<uint64_t> tail_{0};
+  alignas(64) Atomic<uint64_t> free_top_{Pack(kNull, 0)};
+  Atomic<uint32_t> fresh_{0};
+  Atomic<Node*> chunks_[kMaxChunks] = {};
+  std::atomic<bool> is_shutdown_{false};
+  Atomic<size_t> puts_in_flight_{0};
+  EventCount not_empty_;
+};
+
+template <typename T, template <typename U> class Atomic>
+LockFreeQueue<T, Atomic>::~LockFreeQueue() {
+  uint32_t index = IndexOf(NodeAt(IndexOf(head_.load())).next.load());
+  while (index != kNull) {
+    Node& node = NodeAt(index);
+    node.Value()->~T();
+    index = IndexOf(node.next.load());
+  }
+  for (auto& chunk : chunks_) {
+    delete[] chunk.load();
+  }
+}
+
+template <typename T, template <typename U> class Atomic>
+void LockFreeQueue<T, Atomic>::Put(T &&element) {
+  // (5) seq_cst, pairs with (6): either a Get that saw the flag sees us in
+  // flight or we see the flag
+  puts_in_flight_.fetch_add(1, std::memory_order_seq_cst);
+  if (is_shutdown_.load(std::memory_order_seq_cst)) {
+    PutDone();
+    throw ShutdownQueueException();
+  }
+  uint32_t index = kNull;
+  try {
+    index = AllocateNode();
+    new (NodeAt(index).storage) T(std::move(element));
+  } catch (...) {
+    PutDone();
+    throw;
+  }
+  Node& node = NodeAt(index);
+  node.releases.store(0, std::memory_order_relaxed);
+
+  while (true) {
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    Node& last = NodeAt(IndexOf(tail));
+    uint64_t next = last.next.load(std::memory_order_acquire);
+    if (tail != tail_.load(std::memory_order_acquire)) {
+      continue;
+    }
+    if (IndexOf(next) == kNull) {
+      // (1) release: publishes the value to the dequeuer
+      if (last.next.compare_exchange_weak(next, Pack(index, TagOf(next)),
+                                          std::memory_order_release, std::memory_order_relaxed)) {
+        tail_.compare_exchange_strong(tail, Pack(index, TagOf(tail) + 1),
+                                      std::memory_order_release, std::memory_order_relaxed);
+        break;
+      }
+    } else {
+      // tail lags behind, help it
+      tail_.compare_exchange_strong(tail, Pack(IndexOf(next), TagOf(tail) + 1),
+                                    std::memory_order_release, std::memory_order_relaxed);
+    }
+  }
+  PutDone();
+}
+
+template <typename T, template <typename U> class Atomic>
+void LockFreeQueue<T, Atomic>::PutDone() {
+  puts_in_flight_.fetch_sub(1, std::memory_order_seq_cst);
+  // after Shutdown every waiter may be waiting for this Put to land
+  if (is_shutdown_.load(std::memory_order_seq_cst)) {
+    not_empty_.NotifyAll();
+  } else {
+    not_empty_.NotifyOne();
+  }
+}
+
+template <typename T, template <typename U> class Atomic>
+bool LockFreeQueue<T, Atomic>::Get(T &result) {
+  SpinWait spin_wait;
+  while (true) {
+    if (TryGet(result)) {
+      return true;
+    }
+    if (spin_wait.SpinOnce()) {
+      continue;
+    }
+    const EventCount::Key key = not_empty_.PrepareWait();
+    if (TryGet(result)) {
+      not_empty_.CancelWait();
+      return true;
+    }
+    // (6) seq_cst: a Put that missed the flag is still counted here, one
+    // that is no longer counted has linked its node
+    if (is_shutdown_.load(std::memory_order_seq_cst) &&
+        puts_in_flight_.load(std::memory_order_seq_cst) == 0) {
+      not_empty_.CancelWait();
+      return TryGet(result);
+    }
+    not_empty_.CommitWait(key);
+  }
+}
+
+template <typename T, template <typename U> class Atomic>
+bool LockFreeQueue<T, Atomic>::TryGet(T &result) {
+  while (true) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    // (2) acquire, pairs with (1)
+    const uint64_t next = NodeAt(IndexOf(head)).next.load(std::memory_order_acquire);
+    if (head != head_.load(std::memory_order_acquire)) {
+      continue;
+    }
+    if (IndexOf(next) == kNull) {
+      return false;
+    }
+    if (IndexOf(head) == IndexOf(tail)) {
+      // never move head past tail, tail would point to a recycled node
+      uint64_t expected = tail;
+      tail_.compare_exchange_strong(expected, Pack(IndexOf(next), TagOf(tail) + 1),
+                                    std::memory_order_release, std::memory_order_relaxed);
+      continue;
+    }
+    if (head_.compare_exchange_weak(head, Pack(IndexOf(next), TagOf(head) + 1),
+                                    std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      T* value = NodeAt(IndexOf(next)).Value();
+      result = std::move(*value);
+      value->~T();
+      ReleaseNode(IndexOf(head));  // passed as the dummy
+      ReleaseNode(IndexOf(next));  // value consumed
+      return true;
+    }
+  }
+}
+
+template <typename T, template <typename U> class Atomic>
+void LockFreeQueue<T, Atomic>::Shutdown() {
+  is_shutdown_.store(true, std::memory_order_seq_cst);
+  not_empty_.NotifyAll();
+}
+
+// chunk c holds indices [2^k (2^c - 1), 2^k (2^(c+1) - 1)), k = kFirstChunkLog
+template <typename T, template <typename U> class Atomic>
+typename LockFreeQueue<T, Atomic>::Node& LockFreeQueue<T, Atomic>::NodeAt(
+    const uint32_t index) const {
+  const uint64_t shifted = uint64_t{index} + (uint64_t{1} << kFirstChunkLog);
+  const size_t log = 63 - __builtin_clzll(shifted);
+  Node* chunk = chunks_[log - kFirstChunkLog].load(std::memory_order_acquire);
+  return chunk[shifted - (uint64_t{1} << log)];
+}
+
+template <typename T, template <typename U> class Atomic>
+uint32_t LockFreeQueue<T, Atomic>::AllocateNode() {
+  uint64_t top = free_top_.load(std::memory_order_acquire);
+  uint32_t index = kNull;
+  while (IndexOf(top) != kNull) {
+    const uint32_t below = NodeAt(IndexOf(top)).free_next.load(std::memory_order_relaxed);
+    // (3) acquire, pairs with (4): the node's last owner is done with it
+    if (free_top_.compare_exchange_weak(top, Pack(below, TagOf(top) + 1),
+                                        std::memory_order_acquire, std::memory_order_acquire)) {
+      index = IndexOf(top);
+      break;
+    }
+  }
+  if (index == kNull) {
+    return AllocateFreshNode();
+  }
+  // new generation of next: a stale enqueuer cannot link behind this node
+  Node& node = NodeAt(index);
+  const uint64_t next = node.next.load(std::memory_order_relaxed);
+  node.next.store(Pack(kNull, TagOf(next) + 1), std::memory_order_relaxed);
+  return index;
+}
+
+template <typename T, template <typename U> class Atomic>
+uint32_t LockFreeQueue<T, Atomic>::AllocateFreshNode() {
+  const uint32_t index = fresh_.fetch_add(1, std::memory_order_relaxed);
+  const uint64_t shifted = uint64_t{index} + (uint64_t{1} << kFirstChunkLog);
+  const size_t log = 63 - __builtin_clzll(shifted);
+  Atomic<Node*>& chunk = chunks_[log - kFirstChunkLog];
+  if (!chunk.load(std::memory_order_acquire)) {
+    Node* allocated = new Node[size_t{1} << log];
+    Node* expected = nullptr;
+    if (!chunk.compare_exchange_strong(expected, allocated,
+                                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+      delete[] allocated;
+    }
+  }
+  return index;
+}
+
+template <typename T, template <typename U> class Atomic>
+void LockFreeQueue<T, Atomic>::ReleaseNode(const uint32_t index) {
+  Node& node = NodeAt(index);
+  if (node.releases.fetch_add(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  uint64_t top = free_top_.load(std::memory_order_relaxed);
+  do {
+    node.free_next.store(IndexOf(top), std::memory_order_relaxed);
+    // (4) release
+  } while (!free_top_.compare_exchange_weak(top, Pack(index, TagOf(top) + 1),
+                                            std::memory_order_release, std::memory_order_relaxed));
+}
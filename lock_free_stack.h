@@ -3,11 +3,11 @@
 #include <atomic>
 #include <thread>
 
-template<typename T>
+template<typename T, template <typename U> class Atomic = std::atomic>
 class LockFreeStack {
   struct Node {
     Node(const T &_element) : next(nullptr), element(_element) {}
-    std::atomic<Node*> next;
+    Atomic<Node*> next;
     T element;
   };
 
@@ -18,38 +18,42 @@ class LockFreeStack {
   bool Pop(T &ret_value);
 
  private:
-  std::atomic<Node*> prev_top_{nullptr};
-  std::atomic<Node*> top_{nullptr};
+  Atomic<Node*> prev_top_{nullptr};
+  Atomic<Node*> top_{nullptr};
 
   void AddToPoppedNodes(Node *node);
   void ClearOldNodes();
   void ClearActualNodes();
 };
 
-template <typename T>
-LockFreeStack<T>::~LockFreeStack() {
+template <typename T, template <typename U> class Atomic>
+LockFreeStack<T, Atomic>::~LockFreeStack() {
   ClearOldNodes();
   ClearActualNodes();
 }
 
-template <typename T>
-void LockFreeStack<T>::Push(T element) {
-  Node *curr_top = top_.load();
+template <typename T, template <typename U> class Atomic>
+void LockFreeStack<T, Atomic>::Push(T element) {
+  Node *curr_top = top_.load(std::memory_order_relaxed);
   Node *new_top = new Node(element);
-  new_top->next.store(curr_top);
-  while (!top_.compare_exchange_strong(curr_top, new_top)) {
-    new_top->next.store(curr_top);
+  new_top->next.store(curr_top, std::memory_order_relaxed);
+  // (1) release: publishes the node to Pop
+  while (!top_.compare_exchange_strong(curr_top, new_top,
+                                       std::memory_order_release, std::memory_order_relaxed)) {
+    new_top->next.store(curr_top, std::memory_order_relaxed);
   }
 }
 
-template <typename T>
-bool LockFreeStack<T>::Pop(T &ret_value) {
-  Node *curr_top = top_.load();
+template <typename T, template <typename U> class Atomic>
+bool LockFreeStack<T, Atomic>::Pop(T &ret_value) {
+  // (2) acquire, pairs with (1): we read the node's next and element
+  Node *curr_top = top_.load(std::memory_order_acquire);
   while (true) {
     if (!curr_top) {
       return false;
     }
-    if (top_.compare_exchange_strong(curr_top, curr_top->next.load())) {
+    if (top_.compare_exchange_strong(curr_top, curr_top->next.load(std::memory_order_relaxed),
+                                     std::memory_order_acquire, std::memory_order_acquire)) {
       ret_value = curr_top->element;
       AddToPoppedNodes(curr_top);
       return true;
@@ -57,18 +61,20 @@ bool LockFreeStack<T>::Pop(T &ret_value) {
   }
 }
 
-template <typename T>
-void LockFreeStack<T>::AddToPoppedNodes(Node *node) {
-  Node *curr_top = prev_top_.load();
+// popped nodes are only freed by the destructor, after all threads are joined
+template <typename T, template <typename U> class Atomic>
+void LockFreeStack<T, Atomic>::AddToPoppedNodes(Node *node) {
+  Node *curr_top = prev_top_.load(std::memory_order_relaxed);
   Node *new_old_top = node;
-  new_old_top->next.store(curr_top);
-  while (!prev_top_.compare_exchange_strong(curr_top, new_old_top)) {
-    new_old_top->next.store(curr_top);
+  new_old_top->next.store(curr_top, std::memory_order_relaxed);
+  while (!prev_top_.compare_exchange_strong(curr_top, new_old_top,
+                                            std::memory_order_relaxed, std::memory_order_relaxed)) {
+    new_old_top->next.store(curr_top, std::memory_order_relaxed);
   }
 }
 
-template<typename T>
-void LockFreeStack<T>::ClearOldNodes() {
+template <typename T, template <typename U> class Atomic>
+void LockFreeStack<T, Atomic>::ClearOldNodes() {
   while (prev_top_) {
     Node *next = prev_top_.load()->next.load();
     delete prev_top_.load();
@@ -76,8 +82,8 @@ void LockFreeStack<T>::ClearOldNodes() {
   }
 }
 
-template<typename T>
-void LockFreeStack<T>::ClearActualNodes() {
+template <typename T, template <typename U> class Atomic>
+void LockFreeStack<T, Atomic>::ClearActualNodes() {
   while (top_) {
     Node *next = top_.load()->next.load();
     delete top_.load();
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include "thread_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Contention statistics policies for the locks.
+//
+// A lock takes a Stats template parameter and reports to it:
+//   auto probe = stats_.BeginAcquire();
+//   while (lock is busy) { probe.Spin(); ... }
+//   stats_.EndAcquire(probe);        // or EndAcquireShared for readers
+//   ...
+//   stats_.Release();                // exclusive owner only, before unlocking
+//
+// NoLockStats (the default) compiles to nothing.
+// LockStats counts acquisitions, contended acquisitions, spin (or wait)
+// iterations, wait times and exclusive hold times into per-thread shards
+// that are summed on read, and registers itself for DumpLockStats*.
+
+class NoLockStats {
+ public:
+  class Probe {
+   public:
+    void Spin() {}
+  };
+
+  Probe BeginAcquire() {
+    return Probe();
+  }
+
+  void EndAcquire(const Probe&) {}
+  void EndAcquireShared(const Probe&) {}
+  void Release() {}
+};
+
+struct LockStatsSnapshot {
+  std::string name;
+  uint64_t acquisitions = 0;
+  uint64_t contended = 0;
+  uint64_t spins = 0;
+  LatencyHistogram::Snapshot wait_nanos;
+  LatencyHistogram::Snapshot hold_nanos;
+};
+
+class LockStats;
+
+class LockStatsRegistry {
+ public:
+  static LockStatsRegistry& Instance() {
+    static LockStatsRegistry registry;
+    return registry;
+  }
+
+  void Register(LockStats* stats) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    locks_.push_back(stats);
+  }
+
+  void Unregister(LockStats* stats) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    locks_.erase(std::remove(locks_.begin(), locks_.end(), stats), locks_.end());
+  }
+
+  std::vector<LockStatsSnapshot> Collect();
+
+ private:
+  std::mutex mutex_;
+  std::vector<LockStats*> locks_;
+};
+
+class LockStats {
+ public:
+  class Probe {
+   public:
+    void Spin() {
+      ++spins_;
+    }
+
+   private:
+    friend class LockStats;
+    uint64_t start_ = MonotonicNanos();
+    uint64_t spins_ = 0;
+  };
+
+  explicit LockStats(std::string name = "") : name_(std::move(name)) {
+    LockStatsRegistry::Instance().Register(this);
+  }
+
+  ~LockStats() {
+    LockStatsRegistry::Instance().Unregister(this);
+  }
+
+  LockStats(const LockStats&) = delete;
+  LockStats& operator=(const LockStats&) = delete;
+
+  Probe BeginAcquire() {
+    return Probe();
+  }
+
+  void EndAcquire(const Probe& probe) {
+    acquired_at_ = Record(probe);
+  }
+
+  void EndAcquireShared(const Probe& probe) {
+    Record(probe);
+  }
+
+  void Release() {
+    LocalShard().hold_nanos_.Record(MonotonicNanos() - acquired_at_);
+  }
+
+  void SetName(std::string name) {
+    std::unique_lock<std::mutex> lock(name_mutex_);
+    name_ = std::move(name);
+  }
+
+  LockStatsSnapshot Snapshot() const {
+    LockStatsSnapshot snapshot;
+    {
+      std::unique_lock<std::mutex> lock(name_mutex_);
+      snapshot.name = name_;
+    }
+    if (snapshot.name.empty()) {
+      std::ostringstream address;
+      address << "lock@" << static_cast<const void*>(this);
+      snapshot.name = address.str();
+    }
+    for (const Shard& shard : shards_) {
+      snapshot.acquisitions += shard.acquisitions_.load(std::memory_order_relaxed);
+      snapshot.contended += shard.contended_.load(std::memory_order_relaxed);
+      snapshot.spins += shard.spins_.load(std::memory_order_relaxed);
+      snapshot.wait_nanos.Add(shard.wait_nanos_);
+      snapshot.hold_nanos.Add(shard.hold_nanos_);
+    }
+    return snapshot;
+  }
+
+ private:
+  static constexpr size_t kShards = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> spins_{0};
+    LatencyHistogram wait_nanos_;
+    LatencyHistogram hold_nanos_;
+  };
+
+  Shard& LocalShard() {
+    return shards_[ThisThreadIndex() % kShards];
+  }
+
+  uint64_t Record(const Probe& probe) {
+    const uint64_t now = MonotonicNanos();
+    Shard& shard = LocalShard();
+    shard.acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    if (probe.spins_ > 0) {
+      shard.contended_.fetch_add(1, std::memory_order_relaxed);
+      shard.spins_.fetch_add(probe.spins_, std::memory_order_relaxed);
+    }
+    shard.wait_nanos_.Record(now - probe.start_);
+    return now;
+  }
+
+ private:
+  std::string name_;
+  mutable std::mutex name_mutex_;
+  // written by the exclusive owner only
+  uint64_t acquired_at_ = 0;
+  Shard shards_[kShards];
+};
+
+inline std::vector<LockStatsSnapshot> LockStatsRegistry::Collect() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<LockStatsSnapshot> snapshots;
+  for (const LockStats* stats : locks_) {
+    snapshots.push_back(stats->Snapshot());
+  }
+  return snapshots;
+}
+
+inline void DumpLockStatsText(std::ostream& out) {
+  for (const LockStatsSnapshot& lock : LockStatsRegistry::Instance().Collect()) {
+    out << lock.name
+        << " acquisitions=" << lock.acquisitions
+        << " contended=" << lock.contended
+        << " spins=" << lock.spins
+        << " wait_p50_ns=" << lock.wait_nanos.Percentile(0.5)
+        << " wait_p99_ns=" << lock.wait_nanos.Percentile(0.99)
+        << " hold_p50_ns=" << lock.hold_nanos.Percentile(0.5)
+        << " hold_p99_ns=" << lock.hold_nanos.Percentile(0.99) << "\n";
+  }
+}
+
+inline void DumpLockStatsJson(std::ostream& out) {
+  auto dump_histogram = [&out](const LatencyHistogram::Snapshot& histogram) {
+    out << "{\"p50\":" << histogram.Percentile(0.5)
+        << ",\"p99\":" << histogram.Percentile(0.99)
+        << ",\"p999\":" << histogram.Percentile(0.999)
+        << ",\"buckets\":[";
+    bool first = true;
+    for (size_t i = 0; i < LatencyHistogram::kNumBuckets; ++i) {
+      if (histogram.Counts()[i] == 0) {
+        continue;
+      }
+      out << (first ? "" : ",") << "[" << LatencyHistogram::BucketUpperBound(i)
+          << "," << histogram.Counts()[i] << "]";
+      first = false;
+    }
+    out << "]}";
+  };
+
+  out << "[";
+  bool first = true;
+  for (const LockStatsSnapshot& lock : LockStatsRegistry::Instance().Collect()) {
+    out << (first ? "" : ",") << "{\"name\":\"";
+    for (const char c : lock.name) {
+      if (c == '"' || c == '\\') {
+        out << '\\';
+      }
+      out << c;
+    }
+    out << "\",\"acquisitions\":" << lock.acquisitions
+        << ",\"contended\":" << lock.contended
+        << ",\"spins\":" << lock.spins
+        << ",\"wait_ns\":";
+    dump_histogram(lock.wait_nanos);
+    out << ",\"hold_ns\":";
+    dump_histogram(lock.hold_nanos);
+    out << "}";
+    first = false;
+  }
+  out << "]\n";
+}
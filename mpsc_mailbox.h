@@ -0,0 +1,125 @@
+#pragma once
+
+#include "futex.h"
+#include "spin_wait.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+// Intrusive MPSC queue, D. Vyukov's "Non-intrusive MPSC node-based queue"
+// in its intrusive form: a mailbox for an actor with one consumer.
+//
+// Messages derive from MailboxNode and carry the link, so Push never
+// allocates; the mailbox does not own them. Push is one exchange plus a
+// store, wait-free. TryPop is consumer-only and uses only loads in the
+// common case; it may return nullptr while a producer is between its
+// exchange and its link store, even if older messages follow.
+//
+// WaitPop parks the consumer on a futex. Producers read the sleeping flag
+// after their exchange and make the syscall only when the consumer is parked.
+//
+//   struct Letter : MailboxNode { int payload; };
+//   MPSCMailbox<Letter> mailbox;
+//   mailbox.Push(&letter);              // any thread
+//   Letter* next = mailbox.WaitPop();   // the owner
+
+template <template <typename U> class Atomic = std::atomic>
+struct BasicMailboxNode {
+  Atomic<BasicMailboxNode*> mailbox_next{nullptr};
+};
+
+using MailboxNode = BasicMailboxNode<>;
+
+template <class Message, template <typename U> class Atomic = std::atomic>
+class MPSCMailbox {
+  using Node = BasicMailboxNode<Atomic>;
+  static_assert(std::is_base_of<Node, Message>::value,
+                "messages carry the link: derive them from MailboxNode");
+
+ public:
+  MPSCMailbox() : head_(&stub_), tail_(&stub_) {}
+
+  MPSCMailbox(const MPSCMailbox&) = delete;
+  MPSCMailbox& operator=(const MPSCMailbox&) = delete;
+
+  void Push(Message* message) {
+    Link(message);
+    // seq_cst, pairs with (3)-(4): either we see the sleeper
+    // or it sees our exchange
+    if (sleeping_.load() != 0 && sleeping_.exchange(0) != 0) { // (2)
+      FutexWakeOne(sleeping_);
+    }
+  }
+
+  Message* TryPop() {
+    Node* tail = tail_;
+    Node* next = tail->mailbox_next.load(std::memory_order_acquire); // pairs with (1)
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      // skip the stub
+      tail_ = next;
+      tail = next;
+      next = next->mailbox_next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return static_cast<Message*>(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // a producer has exchanged but not linked yet
+      return nullptr;
+    }
+    // tail is the last message: put the stub behind it to take it
+    Link(&stub_);
+    next = tail->mailbox_next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return static_cast<Message*>(tail);
+    }
+    return nullptr;
+  }
+
+  Message* WaitPop() {
+    SpinWait spin_wait;
+    while (true) {
+      if (Message* message = TryPop()) {
+        return message;
+      }
+      if (spin_wait.SpinOnce()) {
+        continue;
+      }
+      sleeping_.store(1); // (3)
+      if (Empty()) { // (4)
+        FutexWait(sleeping_, 1);
+      } else {
+        // a push is in flight, it will be linked shortly
+        std::this_thread::yield();
+      }
+      sleeping_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // consumer only; false also while a push is in flight
+  bool Empty() const {
+    return tail_ == &stub_ && head_.load() == &stub_;
+  }
+
+ private:
+  void Link(Node* node) {
+    node->mailbox_next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head_.exchange(node);
+    prev->mailbox_next.store(node, std::memory_order_release); // (1)
+  }
+
+ private:
+  // producers
+  alignas(64) Atomic<Node*> head_;
+  std::atomic<uint32_t> sleeping_{0};
+  // consumer
+  alignas(64) Node* tail_;
+  Node stub_;
+};
@@ -1,29 +1,27 @@
 #pragma once
 
 #include "arena_allocator.h"
+#include "element_traits.h"
+#include "lock_stats.h"
+#include "sharded_counter.h"
 #include <atomic>
-#include <limits>
 
-template <typename T>
-struct ElementTraits {
-  static T Min() {
-    return std::numeric_limits<T>::min();
-  }
-  static T Max() {
-    return std::numeric_limits<T>::max();
-  }
-};
-
-class SpinLock {
+template <class Stats = NoLockStats, template <typename U> class Atomic = std::atomic>
+class BasicSpinLock {
  public:
-  explicit SpinLock() : locked_(false) {}
+  explicit BasicSpinLock() : locked_(false) {}
 
   void Lock() {
-    while (locked_.test_and_set()) {}
+    auto probe = stats_.BeginAcquire();
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      probe.Spin();
+    }
+    stats_.EndAcquire(probe);
   }
 
   void Unlock() {
-    locked_.clear();
+    stats_.Release();
+    locked_.store(false, std::memory_order_release);
   }
 
   // adapters for BasicLockable concept
@@ -35,18 +33,29 @@ class SpinLock {
     Unlock();
   }
 
+  Stats& GetStats() {
+    return stats_;
+  }
+
  private:
-  std::atomic_flag locked_;
+  Atomic<bool> locked_;
+  [[no_unique_address]] Stats stats_;
 };
 
-template <typename T>
+using SpinLock = BasicSpinLock<>;
+
+// Reads of next_/marked_ outside the node locks are acquire and pair with
+// the release stores made under the locks; reads under the locks are relaxed.
+template <typename T, template <typename U> class Atomic = std::atomic>
 class OptimisticLinkedSet {
  private:
+  using NodeLock = BasicSpinLock<NoLockStats, Atomic>;
+
   struct Node {
     T element_;
-    std::atomic<Node*> next_;
-    SpinLock lock_{};
-    std::atomic<bool> marked_{false};
+    Atomic<Node*> next_;
+    NodeLock lock_{};
+    Atomic<bool> marked_{false};
 
     Node(const T& element, Node* next = nullptr) : element_(element), next_(next) {}
   };
@@ -62,24 +71,24 @@ class OptimisticLinkedSet {
 
  public:
   explicit OptimisticLinkedSet(ArenaAllocator& allocator)
-      : allocator_(allocator),
-        size_(0) {
+      : allocator_(allocator) {
     CreateEmptyList();
   }
 
   bool Insert(const T& element) {
     while (true) {
       const Edge edge_for_insertion = Locate(element);
-      std::unique_lock<SpinLock> lock_pred(edge_for_insertion.pred_->lock_);
-      std::unique_lock<SpinLock> lock_curr(edge_for_insertion.curr_->lock_);
+      std::unique_lock<NodeLock> lock_pred(edge_for_insertion.pred_->lock_);
+      std::unique_lock<NodeLock> lock_curr(edge_for_insertion.curr_->lock_);
       if (Validate(edge_for_insertion)) {
         if (edge_for_insertion.curr_->element_ == element) {
           return false;
         } else {
           Node* node = allocator_.New<Node>(element);
-          node->next_ = edge_for_insertion.curr_;
-          edge_for_insertion.pred_->next_ = node;
-          ++size_;
+          node->next_.store(edge_for_insertion.curr_, std::memory_order_relaxed);
+          // (1) publishes the initialized node to Locate
+          edge_for_insertion.pred_->next_.store(node, std::memory_order_release);
+          size_.Increment();
           return true;
         }
       }
@@ -89,15 +98,18 @@ class OptimisticLinkedSet {
   bool Remove(const T& element) {
     while (true) {
       Edge edge_for_removing = Locate(element);
-      std::unique_lock<SpinLock> lock_pred(edge_for_removing.pred_->lock_);
-      std::unique_lock<SpinLock> lock_curr(edge_for_removing.curr_->lock_);
+      std::unique_lock<NodeLock> lock_pred(edge_for_removing.pred_->lock_);
+      std::unique_lock<NodeLock> lock_curr(edge_for_removing.curr_->lock_);
       if (Validate(edge_for_removing)) {
         if (edge_for_removing.curr_->element_ != element) {
           return false;
         } else {
-          edge_for_removing.curr_->marked_ = true;
-          edge_for_removing.pred_->next_.store(edge_for_removing.curr_->next_);
-          --size_;
+          // (2) logical removal first, then unlink
+          edge_for_removing.curr_->marked_.store(true, std::memory_order_release);
+          edge_for_removing.pred_->next_.store(
+              edge_for_removing.curr_->next_.load(std::memory_order_relaxed),
+              std::memory_order_release);
+          size_.Decrement();
           return true;
         }
       }
@@ -107,38 +119,54 @@ class OptimisticLinkedSet {
   bool Contains(const T& element) const {
     const Edge edge = Locate(element);
 
-    return edge.curr_->element_ == element && !edge.curr_->marked_;
+    return edge.curr_->element_ == element &&
+        !edge.curr_->marked_.load(std::memory_order_acquire); // pairs with (2)
+  }
+
+  // one pass over the counter shards, may miss concurrent updates
+  size_t ApproximateSize() const {
+    const int64_t size = size_.Read();
+    return size > 0 ? static_cast<size_t>(size) : 0;
   }
 
+  // count of the successful Inserts minus Removes: linearizable unless
+  // updates keep landing during its few passes over the shards, then as
+  // ApproximateSize(); exact once updates stop. A linearizable count is
+  // never negative: removing a node locks its predecessor, which the Insert
+  // of the node holds until it has counted it
   size_t Size() const {
-    return size_;
+    int64_t size = 0;
+    size_.TryReadExact(size);
+    return size > 0 ? static_cast<size_t>(size) : 0;
   }
 
  private:
   void CreateEmptyList() {
     head_ = allocator_.New<Node>(ElementTraits<T>::Min());
-    head_->next_ = allocator_.New<Node>(ElementTraits<T>::Max());
+    head_->next_.store(allocator_.New<Node>(ElementTraits<T>::Max()),
+                       std::memory_order_relaxed);
   }
 
   Edge Locate(const T& element) const {
-    Edge edge(this->head_, head_->next_);
+    Edge edge(this->head_, head_->next_.load(std::memory_order_acquire));
     while (edge.curr_->element_ < element) {
       edge.pred_ = edge.curr_;
-      edge.curr_ = edge.curr_->next_;
+      edge.curr_ = edge.curr_->next_.load(std::memory_order_acquire); // pairs with (1)
     }
     return edge;
   }
 
   bool Validate(const Edge& edge) const {
-    return (!((edge.pred_)->marked_) &&
-        !((edge.curr_)->marked_) &&
-        ((edge.pred_)->next_ == edge.curr_));
+    // both nodes are locked: every writer of these fields holds the locks
+    return (!((edge.pred_)->marked_.load(std::memory_order_relaxed)) &&
+        !((edge.curr_)->marked_.load(std::memory_order_relaxed)) &&
+        ((edge.pred_)->next_.load(std::memory_order_relaxed) == edge.curr_));
   }
 
  private:
   ArenaAllocator& allocator_;
   Node* head_{nullptr};
-  std::atomic<size_t> size_;
+  ShardedCounter<Atomic> size_;
 };
 
 template <typename T> using ConcurrentSet = OptimisticLinkedSet<T>;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "latency_histogram.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Occupancy and latency telemetry policies for the queues.
+//
+// NoQueueTelemetry (the default) compiles to nothing.
+// QueueTelemetry tracks the high-water mark, the time producers spend
+// blocked and consumers spend waiting, and enqueue-to-dequeue (sojourn)
+// latency. Sojourn is sampled: every kSamplePeriod-th enqueue is
+// timestamped and matched with the dequeue of the same sequence number,
+// which is exact for FIFO queues. Puts must be serialized among themselves
+// and so must gets (true for BlockingQueue under its mutex and for the
+// single producer/consumer of SPSCRingBuffer).
+
+class NoQueueTelemetry {
+ public:
+  struct Timestamp {};
+
+  Timestamp StartWait() {
+    return Timestamp();
+  }
+
+  void PutBlocked(const Timestamp&) {}
+  void GetWaited(const Timestamp&) {}
+  void Enqueued(const size_t) {}
+  void Dequeued() {}
+  void PutRejected() {}
+  void GetEmpty() {}
+};
+
+struct QueueTelemetrySnapshot {
+  uint64_t puts = 0;
+  uint64_t gets = 0;
+  size_t high_water_mark = 0;
+  // non-blocking queues: failed Publish/Consume calls
+  uint64_t rejected_puts = 0;
+  uint64_t empty_gets = 0;
+  LatencyHistogram::Snapshot put_blocked_nanos;
+  LatencyHistogram::Snapshot get_waited_nanos;
+  LatencyHistogram::Snapshot sojourn_nanos;
+};
+
+class QueueTelemetry {
+ public:
+  using Timestamp = uint64_t;
+
+  static constexpr uint64_t kSamplePeriod = 64;
+  static constexpr size_t kSampleSlots = 1024;
+
+  Timestamp StartWait() {
+    return MonotonicNanos();
+  }
+
+  void PutBlocked(const Timestamp start) {
+    put_blocked_nanos_.Record(MonotonicNanos() - start);
+  }
+
+  void GetWaited(const Timestamp start) {
+    get_waited_nanos_.Record(MonotonicNanos() - start);
+  }
+
+  // depth: number of elements in the queue including the new one
+  void Enqueued(const size_t depth) {
+    const uint64_t seq = puts_.load(std::memory_order_relaxed);
+    puts_.store(seq + 1, std::memory_order_relaxed);
+    if (depth > high_water_mark_.load(std::memory_order_relaxed)) {
+      high_water_mark_.store(depth, std::memory_order_relaxed);
+    }
+    if (seq % kSamplePeriod == 0) {
+      Sample& sample = samples_[(seq / kSamplePeriod) % kSampleSlots];
+      sample.seq_.store(kInvalidSeq, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      sample.nanos_.store(MonotonicNanos(), std::memory_order_relaxed);
+      sample.seq_.store(seq, std::memory_order_release);
+    }
+  }
+
+  void Dequeued() {
+    const uint64_t seq = gets_.load(std::memory_order_relaxed);
+    gets_.store(seq + 1, std::memory_order_relaxed);
+    if (seq % kSamplePeriod == 0) {
+      Sample& sample = samples_[(seq / kSamplePeriod) % kSampleSlots];
+      if (sample.seq_.load(std::memory_order_acquire) != seq) {
+        // overwritten: the queue was deeper than the sample table
+        return;
+      }
+      const uint64_t enqueued_at = sample.nanos_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sample.seq_.load(std::memory_order_relaxed) == seq) {
+        sojourn_nanos_.Record(MonotonicNanos() - enqueued_at);
+      }
+    }
+  }
+
+  void PutRejected() {
+    rejected_puts_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void GetEmpty() {
+    empty_gets_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  QueueTelemetrySnapshot Snapshot() const {
+    QueueTelemetrySnapshot snapshot;
+    snapshot.puts = puts_.load(std::memory_order_relaxed);
+    snapshot.gets = gets_.load(std::memory_order_relaxed);
+    snapshot.high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+    snapshot.rejected_puts = rejected_puts_.load(std::memory_order_relaxed);
+    snapshot.empty_gets = empty_gets_.load(std::memory_order_relaxed);
+    snapshot.put_blocked_nanos.Add(put_blocked_nanos_);
+    snapshot.get_waited_nanos.Add(get_waited_nanos_);
+    snapshot.sojourn_nanos.Add(sojourn_nanos_);
+    return snapshot;
+  }
+
+ private:
+  static constexpr uint64_t kInvalidSeq = ~uint64_t{0};
+
+  struct Sample {
+    std::atomic<uint64_t> seq_{kInvalidSeq};
+    std::atomic<uint64_t> nanos_{0};
+  };
+
+  // producer side
+  alignas(64) std::atomic<uint64_t> puts_{0};
+  std::atomic<size_t> high_water_mark_{0};
+  std::atomic<uint64_t> rejected_puts_{0};
+  LatencyHistogram put_blocked_nanos_;
+
+  // consumer side
+  alignas(64) std::atomic<uint64_t> gets_{0};
+  std::atomic<uint64_t> empty_gets_{0};
+  LatencyHistogram get_waited_nanos_;
+  LatencyHistogram sojourn_nanos_;
+
+  alignas(64) Sample samples_[kSampleSlots];
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "spin_wait.h"
+#include "thread_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Read-mostly value published RCU style: readers pin an immutable snapshot,
+// writers install a new one and free the old one after a grace period.
+//
+//   RcuSnapshot<std::unordered_map<std::string, Route>> routes;
+//   {
+//     auto table = routes.Read();
+//     auto it = table->find(name);
+//     ...
+//   }
+//   routes.Update([&](auto& table) { table[name] = route; });
+//
+// A reader announces the current epoch in its own cache-line slot and loads
+// the pointer; it takes no lock and writes no shared line. A writer swaps the
+// pointer, bumps the epoch and waits until every slot is idle or has
+// announced the new epoch, so no reader can still see the old snapshot.
+//
+// Readers and writers order their slot and pointer accesses Dekker style.
+// Where membarrier(2) expedited is available the reader side is only a
+// compiler barrier and the writer pays for a barrier on every running
+// thread; otherwise both sides use a seq_cst fence.
+//
+// Writers are serialized and wait for the grace period; Publish and Update
+// must not be called while the same thread holds a ReadGuard. Threads with
+// ThisThreadIndex() >= max_threads share one reader counter instead of a slot.
+
+inline bool RegisterMembarrier() {
+  const long commands = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+  return commands > 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+      syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+}
+
+inline bool MembarrierAvailable() {
+  static const bool available = RegisterMembarrier();
+  return available;
+}
+
+template <class T>
+class RcuSnapshot {
+ public:
+  static constexpr size_t kDefaultMaxThreads = 128;
+
+  class ReadGuard {
+   public:
+    ~ReadGuard() {
+      owner_->Exit(slot_);
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    const T& operator*() const {
+      return *snapshot_;
+    }
+
+    const T* operator->() const {
+      return snapshot_;
+    }
+
+    const T* Get() const {
+      return snapshot_;
+    }
+
+   private:
+    friend class RcuSnapshot;
+
+    ReadGuard(const RcuSnapshot* owner, typename RcuSnapshot::Slot* slot, const T* snapshot)
+        : owner_(owner), slot_(slot), snapshot_(snapshot) {}
+
+    const RcuSnapshot* owner_;
+    typename RcuSnapshot::Slot* slot_;
+    const T* snapshot_;
+  };
+
+  explicit RcuSnapshot(T initial = T(), const size_t max_threads = kDefaultMaxThreads)
+      : asymmetric_(MembarrierAvailable()),
+        slots_(new Slot[max_threads]),
+        max_threads_(max_threads),
+        current_(new T(std::move(initial))) {}
+
+  ~RcuSnapshot() {
+    delete current_.load(std::memory_order_relaxed);
+  }
+
+  RcuSnapshot(const RcuSnapshot&) = delete;
+  RcuSnapshot& operator=(const RcuSnapshot&) = delete;
+
+  // the snapshot stays valid until the guard is destroyed; nested reads
+  // on one thread are allowed
+  ReadGuard Read() const {
+    Slot* slot = Enter();
+    return ReadGuard(this, slot, current_.load(std::memory_order_acquire)); // (3)
+  }
+
+  // installs next, returns once no reader can see the previous snapshot
+  void Publish(std::unique_ptr<T> next) {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    Replace(next.release());
+  }
+
+  // copies the current snapshot, applies fn(T&) to the copy and publishes it
+  template <class F>
+  void Update(F&& fn) {
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    auto next = std::make_unique<T>(*current_.load(std::memory_order_relaxed));
+    std::forward<F>(fn)(*next);
+    Replace(next.release());
+  }
+
+ private:
+  struct alignas(64) Slot {
+    // 0 when idle, else the epoch the reader announced
+    std::atomic<uint64_t> epoch_{0};
+    // touched by the owning thread only
+    size_t depth_ = 0;
+  };
+
+  Slot* Enter() const {
+    const size_t index = ThisThreadIndex();
+    if (index >= max_threads_) {
+      overflow_readers_.fetch_add(1, std::memory_order_seq_cst);
+      return nullptr;
+    }
+    Slot& slot = slots_[index];
+    // an inner read keeps the outer announcement, which protects both
+    if (slot.depth_++ == 0) {
+      slot.epoch_.store(epoch_.load(std::memory_order_acquire), // pairs with (4)
+                        std::memory_order_relaxed); // (1)
+      ReaderFence();
+    }
+    return &slot;
+  }
+
+  void Exit(Slot* slot) const {
+    if (slot == nullptr) {
+      overflow_readers_.fetch_sub(1, std::memory_order_release);
+    } else if (--slot->depth_ == 0) {
+      slot->epoch_.store(0, std::memory_order_release); // (2)
+    }
+  }
+
+  void ReaderFence() const {
+    if (asymmetric_) {
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void WriterFence() const {
+    if (asymmetric_) {
+      syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+    } else {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Replace(T* next) {
+    T* previous = current_.exchange(next, std::memory_order_acq_rel);
+    WaitForReaders();
+    delete previous;
+  }
+
+  // grace period: a reader that announced an older epoch may hold the old
+  // snapshot, one that announced the new epoch loaded the new pointer at (3)
+  void WaitForReaders() {
+    const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1; // (4)
+    // either the reader's (1) is visible below or its (3) sees the new pointer
+    WriterFence();
+    const size_t end = std::min(ThreadIndexHighWater(), max_threads_);
+    for (size_t i = 0; i < end; ++i) {
+      SpinWait spin_wait;
+      while (true) {
+        const uint64_t announced = slots_[i].epoch_.load(std::memory_order_acquire); // pairs with (2)
+        if (announced == 0 || announced >= epoch) {
+          break;
+        }
+        if (!spin_wait.SpinOnce()) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    SpinWait spin_wait;
+    while (overflow_readers_.load(std::memory_order_acquire) != 0) {
+      if (!spin_wait.SpinOnce()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  const bool asymmetric_;
+  std::unique_ptr<Slot[]> slots_;
+  const size_t max_threads_;
+  // read-mostly: only writers store to these
+  alignas(64) std::atomic<T*> current_;
+  std::atomic<uint64_t> epoch_{1};
+  alignas(64) mutable std::atomic<size_t> overflow_readers_{0};
+  std::mutex writer_mutex_;
+};
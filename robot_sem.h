@@ -7,31 +7,35 @@
 #include <vector>
 #include <memory>
 
-class Semaphore {
+template <class Mutex = std::mutex, class ConditionVariable = std::condition_variable>
+class BasicSemaphore {
 public:
-    Semaphore(unsigned long long _cnt = 0): cnt_(_cnt) {};
+    BasicSemaphore(unsigned long long _cnt = 0): cnt_(_cnt) {};
 
     void signal() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        if (cnt_.fetch_add(1) == 0) {
+        std::unique_lock<Mutex> lock(mutex_);
+        if (cnt_++ == 0) {
             not_empty_cv_.notify_all();
         }
     }
 
     void wait() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        while (cnt_.load() <= 0) {
+        std::unique_lock<Mutex> lock(mutex_);
+        while (cnt_ <= 0) {
             not_empty_cv_.wait(lock);
         }
-        cnt_.fetch_sub(1);
+        --cnt_;
     }
 
 private:
-    std::atomic<unsigned long long> cnt_;
-    std::mutex mutex_;
-    std::condition_variable not_empty_cv_;
+    // guarded by mutex_
+    unsigned long long cnt_;
+    Mutex mutex_;
+    ConditionVariable not_empty_cv_;
 };
 
+using Semaphore = BasicSemaphore<>;
+
 class Robot {
 public:
     Robot() {
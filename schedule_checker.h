@@ -0,0 +1,477 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Deterministic randomized-schedule checker for the Atomic template hooks.
+//
+// Threads spawned into a ScheduleChecker run one at a time; every operation
+// on a CheckerAtomic is a schedule point where a seeded PRNG picks the next
+// thread to run, so a seed reproduces an interleaving exactly.
+//
+// Weak memory is modelled as x86-TSO: non-seq_cst stores go to a per-thread
+// FIFO store buffer (the owner reads its own buffered values), buffered
+// stores are committed at random schedule points, RMWs and seq_cst stores
+// drain the buffer first. This catches orderings that are too weak for
+// x86 (store->load reordering), not ARM-only reorderings.
+//
+// Limits:
+// - Only store->load reordering is explored. Loads are never reordered or
+//   served stale, std::atomic_thread_fence is not modelled, and acquire,
+//   release and relaxed behave alike apart from seq_cst stores. A
+//   relaxed-instead-of-acquire (or -release) mistake therefore passes here;
+//   on TSO hardware it is harmless, on ARM or POWER it is not. Plain
+//   (non-atomic) fields are not instrumented at all, so a missing
+//   happens-before on the data a node or slot publishes goes unseen.
+//   RunConcurrently covers that part: it runs the same scenarios on free
+//   threads, where CheckerAtomic is a std::atomic with the caller's memory
+//   orders, for a -fsanitize=thread build to check (the structures_check_tsan
+//   test). TSan does not model std::atomic_thread_fence either.
+// - Only structures with an Atomic (or Mutex/ConditionVariable) hook run
+//   here: LockFreeStack, LockFreeQueue, MPSCMailbox, MCSSpinLock,
+//   TASSpinLock, SPSCRingBuffer, OptimisticLinkedSet, SkipListPriorityQueue,
+//   SeqLock, CyclicBarrier and Semaphore. StripedHashSet and its RWLock,
+//   BlockingQueue, TreeMutex and the remaining headers are not covered.
+//
+//   ExploreSchedules(1000, [](ScheduleChecker& checker) {
+//     LockFreeStack<int, CheckerAtomic> stack;
+//     checker.Spawn([&]() { stack.Push(1); });
+//     checker.Spawn([&]() { int x; stack.Pop(x); });
+//     checker.Run();
+//     return /* invariants hold */ true;
+//   });
+//
+// A schedule running longer than max_steps (livelock or lost wakeup)
+// prints its seed and aborts.
+
+class ScheduleChecker {
+ public:
+  explicit ScheduleChecker(const uint64_t seed,
+                           const size_t max_steps = size_t{1} << 20,
+                           const double flush_probability = 0.25)
+      : seed_(seed),
+        random_(seed),
+        max_steps_(max_steps),
+        flush_probability_(flush_probability) {}
+
+  // Run starts the bodies together on plain threads, no schedule points
+  struct FreeRunning {};
+  explicit ScheduleChecker(FreeRunning) : ScheduleChecker(0) {
+    free_running_ = true;
+  }
+
+  ScheduleChecker(const ScheduleChecker&) = delete;
+  ScheduleChecker& operator=(const ScheduleChecker&) = delete;
+
+  void Spawn(std::function<void()> body) {
+    bodies_.push_back(std::move(body));
+  }
+
+  // runs every spawned body to completion under one random schedule
+  void Run() {
+    if (free_running_) {
+      RunFreely();
+      return;
+    }
+    const size_t num_threads = bodies_.size();
+    finished_.assign(num_threads, false);
+    store_buffers_.assign(num_threads, {});
+    num_finished_ = 0;
+    current_ = num_threads ? random_() % num_threads : 0;
+
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < num_threads; ++id) {
+      threads.emplace_back([this, id]() {
+        Context() = ThreadContext{this, id};
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          turn_cv_.wait(lock, [&]() { return current_ == id; });
+        }
+        bodies_[id]();
+        Finish(id);
+        Context() = ThreadContext{};
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    bodies_.clear();
+  }
+
+  uint64_t Seed() const {
+    return seed_;
+  }
+
+  // ---- used by CheckerAtomic ----
+
+  static ScheduleChecker* Current() {
+    return Context().checker_;
+  }
+
+  void SchedulePoint() {
+    const size_t me = Context().id_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (++steps_ > max_steps_) {
+      std::cerr << "schedule checker: step limit exceeded, seed " << seed_ << std::endl;
+      std::abort();
+    }
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(random_) < flush_probability_) {
+      CommitRandomStore();
+    }
+    const size_t next = PickRunnable();
+    if (next != me) {
+      current_ = next;
+      turn_cv_.notify_all();
+      turn_cv_.wait(lock, [&]() { return current_ == me; });
+    }
+  }
+
+  bool LoadBuffered(const void* target, uint64_t& raw) const {
+    const auto& buffer = store_buffers_[Context().id_];
+    for (auto it = buffer.rbegin(); it != buffer.rend(); ++it) {
+      if (it->target_ == target) {
+        raw = it->raw_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void BufferStore(void* target, const uint64_t raw, void (*commit)(void*, uint64_t)) {
+    store_buffers_[Context().id_].push_back(BufferedStore{target, raw, commit});
+  }
+
+  void DrainOwnBuffer() {
+    auto& buffer = store_buffers_[Context().id_];
+    while (!buffer.empty()) {
+      buffer.front().Commit();
+      buffer.pop_front();
+    }
+  }
+
+ private:
+  struct ThreadContext {
+    ScheduleChecker* checker_ = nullptr;
+    size_t id_ = 0;
+  };
+
+  struct BufferedStore {
+    void* target_;
+    uint64_t raw_;
+    void (*commit_)(void*, uint64_t);
+
+    void Commit() const {
+      commit_(target_, raw_);
+    }
+  };
+
+  static ThreadContext& Context() {
+    static thread_local ThreadContext context;
+    return context;
+  }
+
+  void RunFreely() {
+    const size_t num_threads = bodies_.size();
+    std::atomic<size_t> started{0};
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < num_threads; ++id) {
+      threads.emplace_back([&, id]() {
+        // line the threads up so the bodies overlap
+        started.fetch_add(1);
+        while (started.load() < num_threads) {
+          std::this_thread::yield();
+        }
+        bodies_[id]();
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    bodies_.clear();
+  }
+
+  void Finish(const size_t me) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    DrainOwnBuffer();
+    finished_[me] = true;
+    ++num_finished_;
+    if (num_finished_ < finished_.size()) {
+      current_ = PickRunnable();
+      turn_cv_.notify_all();
+    }
+  }
+
+  size_t PickRunnable() {
+    const size_t num_runnable = finished_.size() - num_finished_;
+    size_t skip = random_() % num_runnable;
+    for (size_t id = 0; id < finished_.size(); ++id) {
+      if (!finished_[id] && skip-- == 0) {
+        return id;
+      }
+    }
+    return current_;
+  }
+
+  void CommitRandomStore() {
+    std::vector<size_t> pending;
+    for (size_t id = 0; id < store_buffers_.size(); ++id) {
+      if (!store_buffers_[id].empty()) {
+        pending.push_back(id);
+      }
+    }
+    if (pending.empty()) {
+      return;
+    }
+    auto& buffer = store_buffers_[pending[random_() % pending.size()]];
+    buffer.front().Commit();
+    buffer.pop_front();
+  }
+
+ private:
+  uint64_t seed_;
+  std::mt19937_64 random_;
+  size_t max_steps_;
+  double flush_probability_;
+  bool free_running_ = false;
+  size_t steps_ = 0;
+
+  std::vector<std::function<void()>> bodies_;
+  std::vector<bool> finished_;
+  size_t num_finished_ = 0;
+  std::vector<std::deque<BufferedStore>> store_buffers_;
+
+  std::mutex mutex_;
+  std::condition_variable turn_cv_;
+  size_t current_ = 0;
+};
+
+// Drop-in for std::atomic<T> (T trivially copyable, at most 8 bytes).
+// Outside a scheduled run (free-running or single-threaded) it is the
+// std::atomic<T> it wraps, with the memory orders it is given.
+template <typename T>
+class CheckerAtomic {
+  static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(uint64_t),
+                "CheckerAtomic models word-sized values only");
+
+ public:
+  CheckerAtomic() : value_() {}
+  CheckerAtomic(T value) : value_(value) {}
+
+  CheckerAtomic(const CheckerAtomic&) = delete;
+  CheckerAtomic& operator=(const CheckerAtomic&) = delete;
+
+  // a scheduled run hands the threads over under a mutex, so the memory
+  // orders passed through below only matter outside one
+  T load(const std::memory_order order = std::memory_order_seq_cst) const {
+    ScheduleChecker* checker = ScheduleChecker::Current();
+    if (checker) {
+      checker->SchedulePoint();
+      uint64_t raw = 0;
+      if (checker->LoadBuffered(this, raw)) {
+        return FromRaw(raw);
+      }
+    }
+    return value_.load(order);
+  }
+
+  void store(T value, const std::memory_order order = std::memory_order_seq_cst) {
+    ScheduleChecker* checker = ScheduleChecker::Current();
+    if (!checker) {
+      value_.store(value, order);
+      return;
+    }
+    checker->SchedulePoint();
+    if (order == std::memory_order_seq_cst) {
+      checker->DrainOwnBuffer();
+      value_.store(value, order);
+    } else {
+      checker->BufferStore(this, ToRaw(value), &Commit);
+    }
+  }
+
+  T exchange(T value, const std::memory_order order = std::memory_order_seq_cst) {
+    BeginReadModifyWrite();
+    return value_.exchange(value, order);
+  }
+
+  // never fails spuriously, even as compare_exchange_weak
+  bool compare_exchange_strong(T& expected, T desired,
+                               const std::memory_order success,
+                               const std::memory_order failure) {
+    BeginReadModifyWrite();
+    return value_.compare_exchange_strong(expected, desired, success, failure);
+  }
+
+  // the failure order follows from order, as for std::atomic
+  bool compare_exchange_strong(T& expected, T desired,
+                               const std::memory_order order = std::memory_order_seq_cst) {
+    BeginReadModifyWrite();
+    return value_.compare_exchange_strong(expected, desired, order);
+  }
+
+  bool compare_exchange_weak(T& expected, T desired,
+                             const std::memory_order success,
+                             const std::memory_order failure) {
+    return compare_exchange_strong(expected, desired, success, failure);
+  }
+
+  bool compare_exchange_weak(T& expected, T desired,
+                             const std::memory_order order = std::memory_order_seq_cst) {
+    return compare_exchange_strong(expected, desired, order);
+  }
+
+  template <typename U>
+  T fetch_add(const U delta, const std::memory_order order = std::memory_order_seq_cst) {
+    BeginReadModifyWrite();
+    return value_.fetch_add(delta, order);
+  }
+
+  template <typename U>
+  T fetch_sub(const U delta, const std::memory_order order = std::memory_order_seq_cst) {
+    BeginReadModifyWrite();
+    return value_.fetch_sub(delta, order);
+  }
+
+  operator T() const {
+    return load();
+  }
+
+  T operator=(T value) {
+    store(value);
+    return value;
+  }
+
+  T operator++() {
+    return fetch_add(1) + 1;
+  }
+
+  T operator--() {
+    return fetch_sub(1) - 1;
+  }
+
+ private:
+  void BeginReadModifyWrite() {
+    ScheduleChecker* checker = ScheduleChecker::Current();
+    if (checker) {
+      checker->SchedulePoint();
+      // locked instructions drain the store buffer
+      checker->DrainOwnBuffer();
+    }
+  }
+
+  static uint64_t ToRaw(T value) {
+    uint64_t raw = 0;
+    std::memcpy(&raw, &value, sizeof(T));
+    return raw;
+  }
+
+  static T FromRaw(const uint64_t raw) {
+    T value;
+    std::memcpy(&value, &raw, sizeof(T));
+    return value;
+  }
+
+  static void Commit(void* target, const uint64_t raw) {
+    static_cast<CheckerAtomic*>(target)->value_.store(FromRaw(raw), std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<T> value_;
+};
+
+// Mutex and condition variable built on CheckerAtomic, so that blocking
+// structures (CyclicBarrier, Semaphore) run under the checker too.
+// Waiting spins through schedule points instead of parking, and yields
+// the CPU on free-running threads.
+
+class CheckerMutex {
+ public:
+  void lock() {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  bool try_lock() {
+    return !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() {
+    locked_.store(false, std::memory_order_release);
+  }
+
+ private:
+  CheckerAtomic<bool> locked_{false};
+};
+
+class CheckerConditionVariable {
+ public:
+  template <class Lock>
+  void wait(Lock& lock) {
+    const uint64_t epoch = epoch_.load();
+    lock.unlock();
+    while (epoch_.load() == epoch) {
+      std::this_thread::yield();
+    }
+    lock.lock();
+  }
+
+  template <class Lock, class Predicate>
+  void wait(Lock& lock, Predicate predicate) {
+    while (!predicate()) {
+      wait(lock);
+    }
+  }
+
+  void notify_one() {
+    epoch_.fetch_add(1);
+  }
+
+  void notify_all() {
+    epoch_.fetch_add(1);
+  }
+
+ private:
+  CheckerAtomic<uint64_t> epoch_{0};
+};
+
+// Runs `schedule` under num_schedules seeds starting from first_seed,
+// returns false and reports the seed on the first failed invariant
+template <class Schedule>
+bool ExploreSchedules(const size_t num_schedules, Schedule schedule,
+                      const uint64_t first_seed = 1) {
+  for (uint64_t seed = first_seed; seed < first_seed + num_schedules; ++seed) {
+    ScheduleChecker checker(seed);
+    if (!schedule(checker)) {
+      std::cerr << "schedule checker: invariant violated, seed " << seed << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs `schedule` num_runs times on free-running threads, returns false on
+// the first failed invariant. Meant for a -fsanitize=thread build: the
+// memory orders are real here, so TSan sees what they fail to publish.
+template <class Schedule>
+bool RunConcurrently(const size_t num_runs, Schedule schedule) {
+  for (size_t run = 0; run < num_runs; ++run) {
+    ScheduleChecker checker{ScheduleChecker::FreeRunning{}};
+    if (!schedule(checker)) {
+      std::cerr << "free run: invariant violated, run " << run << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "spin_wait.h"
+#include "tas_spinlock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Sequence lock for a small trivially copyable record that is read far
+// more often than written.
+//
+// The writer makes the sequence odd, stores the record, and makes it even
+// again. A reader copies the record between two sequence loads and retries
+// if the sequence was odd or changed; it never writes shared memory, so
+// readers on different cores do not bounce any cache line between them.
+// The record is kept as relaxed atomic words: a torn copy is not a data
+// race, it is only discarded (Boehm, "Can Seqlocks Get Along with
+// Programming Language Memory Models?").
+//
+//   SeqLock<Quote> quote;
+//   quote.Store({bid, ask});              // one writer thread
+//   Quote current = quote.Load();         // any thread
+//
+// WriterLock serializes writers: NoWriterLock for a single writer thread,
+// TASSpinLock (MultiWriterSeqLock) for several. Writers can starve readers.
+
+class NoWriterLock {
+ public:
+  void Lock() {}
+  void Unlock() {}
+};
+
+template <class T, class WriterLock = NoWriterLock,
+          template <typename U> class Atomic = std::atomic>
+class alignas(64) BasicSeqLock {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies T bytewise");
+  static_assert(std::is_default_constructible<T>::value, "Load() returns a copy of T");
+
+ public:
+  BasicSeqLock() : BasicSeqLock(T()) {}
+
+  explicit BasicSeqLock(const T& initial) {
+    uint64_t buffer[kWords] = {};
+    std::memcpy(buffer, &initial, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+    }
+  }
+
+  BasicSeqLock(const BasicSeqLock&) = delete;
+  BasicSeqLock& operator=(const BasicSeqLock&) = delete;
+
+  // copies a consistent record into out, returns its version
+  uint64_t Load(T& out) const {
+    SpinWait spin_wait;
+    uint64_t version;
+    while (!TryLoad(out, version)) {
+      if (!spin_wait.SpinOnce()) {
+        std::this_thread::yield();
+      }
+    }
+    return version;
+  }
+
+  T Load() const {
+    T value;
+    Load(value);
+    return value;
+  }
+
+  // a single attempt, fails while a write overlaps it
+  bool TryLoad(T& out) const {
+    uint64_t version;
+    return TryLoad(out, version);
+  }
+
+  // even between writes, bumped by two on every Store
+  uint64_t Version() const {
+    return sequence_.load(std::memory_order_acquire);
+  }
+
+  void Store(const T& value) {
+    uint64_t buffer[kWords] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+    writer_lock_.Lock();
+    Write(buffer);
+    writer_lock_.Unlock();
+  }
+
+  // applies fn(T&) to the current record and stores the result
+  template <class F>
+  void Update(F&& fn) {
+    writer_lock_.Lock();
+    // writers are serialized: the words are stable here
+    uint64_t buffer[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    T value;
+    std::memcpy(&value, buffer, sizeof(T));
+    std::forward<F>(fn)(value);
+    std::memcpy(buffer, &value, sizeof(T));
+    Write(buffer);
+    writer_lock_.Unlock();
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  bool TryLoad(T& out, uint64_t& version) const {
+    version = sequence_.load(std::memory_order_acquire); // (1) pairs with (3)
+    if (version & 1) {
+      return false;
+    }
+    uint64_t buffer[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    // keeps the word loads above the recheck
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != version) { // pairs with (2)
+      return false;
+    }
+    std::memcpy(&out, buffer, sizeof(T));
+    return true;
+  }
+
+  // called with the writer lock held
+  void Write(const uint64_t (&buffer)[kWords]) {
+    const uint64_t version = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(version + 1, std::memory_order_relaxed);
+    // keeps the word stores below the odd sequence
+    std::atomic_thread_fence(std::memory_order_release); // (2)
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+    }
+    sequence_.store(version + 2, std::memory_order_release); // (3)
+  }
+
+ private:
+  Atomic<uint64_t> sequence_{0};
+  Atomic<uint64_t> words_[kWords];
+  [[no_unique_address]] WriterLock writer_lock_;
+};
+
+template <class T>
+using SeqLock = BasicSeqLock<T>;
+
+template <class T>
+using MultiWriterSeqLock = BasicSeqLock<T, TASSpinLock>;
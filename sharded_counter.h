@@ -0,0 +1,83 @@
+#pragma once
+
+#include "thread_index.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Counter split into cache-line-sized shards picked by ThisThreadIndex(),
+// so concurrent updates from different threads rarely share a line.
+//
+// Read() sums one pass over the shards: it is exact once updates stop, and
+// during updates it may miss some of them (it can even be transiently
+// negative). TryReadExact() is linearizable when it succeeds: every shard
+// keeps what was added and what was subtracted in two counters that only
+// grow, so two passes that see the same values saw a moment when nothing
+// changed. Under a steady stream of updates the passes rarely agree, so it
+// gives up after kExactReadPasses and leaves the last pass, as Read().
+
+template <template <typename U> class Atomic = std::atomic>
+class ShardedCounter {
+ public:
+  static constexpr size_t kShards = 32;
+  static constexpr size_t kExactReadPasses = 4;
+
+  void Add(const int64_t delta) {
+    Shard& shard = shards_[ThisThreadIndex() % kShards];
+    if (delta >= 0) {
+      shard.added_.fetch_add(static_cast<uint64_t>(delta), std::memory_order_relaxed);
+    } else {
+      shard.subtracted_.fetch_add(static_cast<uint64_t>(-delta), std::memory_order_relaxed);
+    }
+  }
+
+  void Increment() {
+    Add(1);
+  }
+
+  void Decrement() {
+    Add(-1);
+  }
+
+  int64_t Read() const {
+    uint64_t added = 0;
+    uint64_t subtracted = 0;
+    for (const Shard& shard : shards_) {
+      added += shard.added_.load(std::memory_order_relaxed);
+      subtracted += shard.subtracted_.load(std::memory_order_relaxed);
+    }
+    return static_cast<int64_t>(added - subtracted);
+  }
+
+  // false if no two consecutive passes agreed, sum is then the last pass
+  bool TryReadExact(int64_t& sum) const {
+    uint64_t added[kShards];
+    uint64_t subtracted[kShards];
+    for (size_t pass = 0; pass < kExactReadPasses; ++pass) {
+      bool changed = pass == 0;
+      uint64_t pass_sum = 0;
+      for (size_t i = 0; i < kShards; ++i) {
+        const uint64_t shard_added = shards_[i].added_.load(std::memory_order_seq_cst);
+        const uint64_t shard_subtracted = shards_[i].subtracted_.load(std::memory_order_seq_cst);
+        changed = changed || shard_added != added[i] || shard_subtracted != subtracted[i];
+        added[i] = shard_added;
+        subtracted[i] = shard_subtracted;
+        pass_sum += shard_added - shard_subtracted;
+      }
+      sum = static_cast<int64_t>(pass_sum);
+      if (!changed) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    Atomic<uint64_t> added_{0};
+    Atomic<uint64_t> subtracted_{0};
+  };
+
+  Shard shards_[kShards];
+};
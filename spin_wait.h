@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+// Hint to the CPU that we are inside a spin loop
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Bounded spinning: pause for the first iterations, then yield the core.
+// SpinOnce returns false when the caller should stop spinning and block.
+class SpinWait {
+ public:
+  explicit SpinWait(const size_t spin_limit = 128, const size_t yield_limit = 16)
+      : spin_limit_(spin_limit), yield_limit_(yield_limit) {}
+
+  bool SpinOnce() {
+    if (iteration_ < spin_limit_) {
+      CpuRelax();
+    } else if (iteration_ < spin_limit_ + yield_limit_) {
+      std::this_thread::yield();
+    } else {
+      return false;
+    }
+    ++iteration_;
+    return true;
+  }
+
+  size_t Iterations() const {
+    return iteration_;
+  }
+
+  void Reset() {
+    iteration_ = 0;
+  }
+
+ private:
+  size_t spin_limit_;
+  size_t yield_limit_;
+  size_t iteration_ = 0;
+};
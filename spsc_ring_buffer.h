@@ -1,11 +1,14 @@
 #pragma once
 
+#include "queue_telemetry.h"
+
 #include <atomic>
 #include <vector>
 
 // Single-Producer/Single-Consumer Fixed-Size Ring Buffer (Queue)
 
-template <typename T>
+template <typename T, class Telemetry = NoQueueTelemetry,
+          template <typename U> class Atomic = std::atomic>
 class SPSCRingBuffer {
  public:
   explicit SPSCRingBuffer(const size_t capacity)
@@ -17,10 +20,13 @@ class SPSCRingBuffer {
       const size_t curr_tail = tail_.load(std::memory_order_relaxed); // (2)
 
       if (Full(curr_head, curr_tail)) {
+          telemetry_.PutRejected();
           return false;
       }
 
       buffer_[curr_tail] = element;
+      // before (3), so the sampled timestamp is published with the element
+      telemetry_.Enqueued(Depth(curr_head, Next(curr_tail)));
       tail_.store(Next(curr_tail), std::memory_order_release); // (3)
       return true;
   }
@@ -30,14 +36,20 @@ class SPSCRingBuffer {
       const size_t curr_tail = tail_.load(std::memory_order_acquire); // (5)
 
       if (Empty(curr_head, curr_tail)) {
+          telemetry_.GetEmpty();
           return false;
       }
 
       element = buffer_[curr_head];
       head_.store(Next(curr_head), std::memory_order_release); // (6)
+      telemetry_.Dequeued();
       return true;
   }
 
+  Telemetry& GetTelemetry() {
+      return telemetry_;
+  }
+
  private:
   bool Full(const size_t head, const size_t tail) const {
       return Next(tail) == head;
@@ -51,8 +63,13 @@ class SPSCRingBuffer {
       return (slot + 1) % buffer_.size();
   }
 
+  size_t Depth(const size_t head, const size_t tail) const {
+      return (tail + buffer_.size() - head) % buffer_.size();
+  }
+
  private:
   std::vector<T> buffer_;
-  std::atomic<size_t> tail_{0};
-  std::atomic<size_t> head_{0};
+  Atomic<size_t> tail_{0};
+  Atomic<size_t> head_{0};
+  [[no_unique_address]] Telemetry telemetry_;
 };
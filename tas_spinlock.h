@@ -1,22 +1,48 @@
 #pragma once
 
+#include "lock_stats.h"
+
 #include <atomic>
 #include <mutex>
+#include <thread>
 
 // Test-And-Set spinlock
-class TASSpinLock {
+template <class Stats = NoLockStats, template <typename U> class Atomic = std::atomic>
+class BasicTASSpinLock {
  public:
   void Lock() {
+    auto probe = stats_.BeginAcquire();
     while (locked_.exchange(true, std::memory_order_acquire)) { // (1)
+      probe.Spin();
       std::this_thread::yield();
     }
+    stats_.EndAcquire(probe);
+  }
+
+  // the relaxed load keeps a busy lock's line shared
+  bool TryLock() {
+    auto probe = stats_.BeginAcquire();
+    if (locked_.load(std::memory_order_relaxed) ||
+        locked_.exchange(true, std::memory_order_acquire)) { // (1)
+      return false;
+    }
+    stats_.EndAcquire(probe);
+    return true;
   }
 
   void Unlock() {
+    stats_.Release();
     locked_.store(false, std::memory_order_release); // (2)
   }
 
+  Stats& GetStats() {
+    return stats_;
+  }
+
  private:
-  std::atomic<bool> locked_{false};
+  Atomic<bool> locked_{false};
+  [[no_unique_address]] Stats stats_;
 };
 
+using TASSpinLock = BasicTASSpinLock<>;
+
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Dense index of the calling thread: 0, 1, 2, ...
+// An index is returned to the pool when its thread exits,
+// so live threads always have indexes below ThreadIndexHighWater().
+
+class ThreadIndexPool {
+ public:
+  static ThreadIndexPool& Instance() {
+    static ThreadIndexPool pool;
+    return pool;
+  }
+
+  size_t Acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      const size_t index = free_.back();
+      free_.pop_back();
+      return index;
+    }
+    return high_water_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void Release(const size_t index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_.push_back(index);
+  }
+
+  size_t HighWater() const {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<size_t> free_;
+  std::atomic<size_t> high_water_{0};
+};
+
+inline size_t ThisThreadIndex() {
+  struct Holder {
+    Holder() : index_(ThreadIndexPool::Instance().Acquire()) {}
+    ~Holder() {
+      ThreadIndexPool::Instance().Release(index_);
+    }
+    size_t index_;
+  };
+  static thread_local Holder holder;
+  return holder.index_;
+}
+
+inline size_t ThreadIndexHighWater() {
+  return ThreadIndexPool::Instance().HighWater();
+}
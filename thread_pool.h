@@ -0,0 +1,318 @@
+#pragma once
+
+#include "blocking_queue.h"
+#include "chase_lev_deque.h"
+#include "event_count.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size work-stealing executor.
+// Every worker owns a Chase-Lev deque (LIFO for the owner, FIFO for thieves),
+// external submissions go through a shared injection queue,
+// idle workers sleep on an eventcount.
+// Queues hold intrusive TaskNodes: Schedule(Task) wraps the function in a
+// heap node, TrySchedule(TaskNode*) enqueues a node the caller owns without
+// allocating.
+
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  // Run is called once on a worker; the node may be destroyed from Run,
+  // the pool does not touch it afterwards
+  class TaskNode {
+   public:
+    virtual void Run() = 0;
+
+   protected:
+    ~TaskNode() = default;
+
+   private:
+    friend class ThreadPool;
+    TaskNode* next_task_ = nullptr;  // injection queue link
+  };
+
+  explicit ThreadPool(const size_t num_workers = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // throws ShutdownQueueException if called from outside after Shutdown
+  template <class F>
+  auto Submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+
+  // fire-and-forget Submit without the future, same shutdown rule
+  void Schedule(Task task);
+
+  // returns false instead of throwing after Shutdown, the node then stays
+  // with the caller
+  bool TrySchedule(TaskNode* node);
+
+  // runs body(i) for i in [begin, end), the caller helps until all chunks are done
+  template <class F>
+  void ParallelFor(const size_t begin, const size_t end, F&& body);
+
+  // completes already submitted tasks, then joins the workers
+  void Shutdown();
+
+  size_t NumWorkers() const {
+    return workers_.size();
+  }
+
+ private:
+  class FunctionTask final : public TaskNode {
+   public:
+    explicit FunctionTask(Task task) : task_(std::move(task)) {}
+
+    void Run() override {
+      std::unique_ptr<FunctionTask> self(this);
+      task_();
+    }
+
+   private:
+    Task task_;
+  };
+
+  struct alignas(64) WorkerQueue {
+    ChaseLevDeque<TaskNode*> tasks_;
+  };
+
+  struct WorkerContext {
+    ThreadPool* pool_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  static WorkerContext& CurrentWorker() {
+    static thread_local WorkerContext context;
+    return context;
+  }
+
+  void WorkerLoop(const size_t index);
+  TaskNode* TakeTask();
+  TaskNode* PopLocal(const size_t index);
+  TaskNode* PopInjected();
+  TaskNode* Steal(const size_t start);
+
+  static constexpr size_t kChunksPerWorker = 4;
+
+ private:
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex injection_mutex_;
+  TaskNode* injection_head_ = nullptr;
+  TaskNode* injection_tail_ = nullptr;
+  // written under injection_mutex_, read without it to skip an empty list
+  std::atomic<size_t> num_injected_{0};
+  std::atomic<bool> is_shutdown_{false};
+  bool is_joined_ = false;
+  std::mutex shutdown_mutex_;
+  EventCount idle_;
+};
+
+inline ThreadPool::ThreadPool(const size_t num_workers) {
+  const size_t count = std::max<size_t>(num_workers, 1);
+  for (size_t i = 0; i < count; ++i) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (size_t i = 0; i < count; ++i) {
+    workers_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  Shutdown();
+}
+
+template <class F>
+auto ThreadPool::Submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+  using Result = std::invoke_result_t<std::decay_t<F>>;
+  auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+  std::future<Result> future = task->get_future();
+  Schedule([task]() { (*task)(); });
+  return future;
+}
+
+template <class F>
+void ThreadPool::ParallelFor(const size_t begin, const size_t end, F&& body) {
+  if (begin >= end) {
+    return;
+  }
+  const size_t num_chunks = std::min(end - begin, workers_.size() * kChunksPerWorker);
+  const size_t chunk_size = (end - begin + num_chunks - 1) / num_chunks;
+
+  std::atomic<size_t> pending{(end - begin + chunk_size - 1) / chunk_size};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto record_error = [&](std::exception_ptr exception) {
+    std::unique_lock<std::mutex> lock(error_mutex);
+    if (!error) {
+      error = exception;
+    }
+  };
+
+  for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size) {
+    const size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+    try {
+      Schedule([&, chunk_begin, chunk_end]() {
+        try {
+          for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            body(i);
+          }
+        } catch (...) {
+          record_error(std::current_exception());
+        }
+        pending.fetch_sub(1, std::memory_order_release);
+      });
+    } catch (...) {
+      // pool was shut down under us: account for the chunks never scheduled
+      record_error(std::current_exception());
+      const size_t skipped = (end - chunk_begin + chunk_size - 1) / chunk_size;
+      pending.fetch_sub(skipped, std::memory_order_release);
+      break;
+    }
+  }
+
+  while (pending.load(std::memory_order_acquire) > 0) {
+    if (TaskNode* task = TakeTask()) {
+      task->Run();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+inline void ThreadPool::Shutdown() {
+  std::unique_lock<std::mutex> lock(shutdown_mutex_);
+  if (is_joined_) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> injection_lock(injection_mutex_);
+    is_shutdown_.store(true, std::memory_order_release);
+  }
+  idle_.NotifyAll();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  is_joined_ = true;
+}
+
+inline void ThreadPool::Schedule(Task task) {
+  auto node = std::make_unique<FunctionTask>(std::move(task));
+  if (!TrySchedule(node.get())) {
+    throw ShutdownQueueException();
+  }
+  node.release();
+}
+
+inline bool ThreadPool::TrySchedule(TaskNode* node) {
+  const WorkerContext& context = CurrentWorker();
+  if (context.pool_ == this) {
+    queues_[context.index_]->tasks_.Push(node);
+  } else {
+    std::unique_lock<std::mutex> lock(injection_mutex_);
+    if (is_shutdown_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    node->next_task_ = nullptr;
+    if (injection_tail_) {
+      injection_tail_->next_task_ = node;
+    } else {
+      injection_head_ = node;
+    }
+    injection_tail_ = node;
+    // ordered before NotifyOne's fence
+    num_injected_.fetch_add(1, std::memory_order_relaxed);
+  }
+  idle_.NotifyOne();
+  return true;
+}
+
+inline void ThreadPool::WorkerLoop(const size_t index) {
+  CurrentWorker() = WorkerContext{this, index};
+  while (true) {
+    if (TaskNode* task = TakeTask()) {
+      task->Run();
+      continue;
+    }
+    const EventCount::Key key = idle_.PrepareWait();
+    // read the flag before the last scan: everything injected before
+    // Shutdown is visible to that scan
+    const bool is_shutdown = is_shutdown_.load(std::memory_order_acquire);
+    if (TaskNode* task = TakeTask()) {
+      idle_.CancelWait();
+      task->Run();
+      continue;
+    }
+    if (is_shutdown) {
+      idle_.CancelWait();
+      return;
+    }
+    idle_.CommitWait(key);
+  }
+}
+
+inline ThreadPool::TaskNode* ThreadPool::TakeTask() {
+  const WorkerContext& context = CurrentWorker();
+  if (context.pool_ == this) {
+    if (TaskNode* task = PopLocal(context.index_)) {
+      return task;
+    }
+    if (TaskNode* task = PopInjected()) {
+      return task;
+    }
+    return Steal(context.index_ + 1);
+  }
+  if (TaskNode* task = PopInjected()) {
+    return task;
+  }
+  return Steal(0);
+}
+
+inline ThreadPool::TaskNode* ThreadPool::PopLocal(const size_t index) {
+  TaskNode* task = nullptr;
+  return queues_[index]->tasks_.Pop(task) ? task : nullptr;
+}
+
+inline ThreadPool::TaskNode* ThreadPool::PopInjected() {
+  // seq_cst: pairs with the eventcount, a worker about to sleep either
+  // sees the count or gets the NotifyOne
+  if (num_injected_.load(std::memory_order_seq_cst) == 0) {
+    return nullptr;
+  }
+  std::unique_lock<std::mutex> lock(injection_mutex_);
+  TaskNode* task = injection_head_;
+  if (task) {
+    injection_head_ = task->next_task_;
+    if (!injection_head_) {
+      injection_tail_ = nullptr;
+    }
+    num_injected_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+inline ThreadPool::TaskNode* ThreadPool::Steal(const size_t start) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    TaskNode* task = nullptr;
+    if (queues_[(start + i) % queues_.size()]->tasks_.Steal(task)) {
+      return task;
+    }
+  }
+  return nullptr;
+}
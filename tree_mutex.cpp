@@ -1,3 +1,6 @@
+#include "lock_stats.h"
+
+#include <array>
 #include <atomic>
 #include <thread>
 #include <vector>
@@ -10,7 +13,8 @@ public:
 
     peterson_mutex &operator=(const peterson_mutex &other) = delete;
 
-    void lock(std::size_t id);
+    template <class Probe>
+    void lock(std::size_t id, Probe &probe);
 
     void unlock(std::size_t id);
 
@@ -21,38 +25,49 @@ private:
     std::size_t other(std::size_t id);
 };
 
-class TreeMutex {
+template <class Stats = NoLockStats>
+class BasicTreeMutex {
 public:
-    TreeMutex(std::size_t n_threads);
+    BasicTreeMutex(std::size_t n_threads);
 
-    TreeMutex(const TreeMutex &) = delete;
+    BasicTreeMutex(const BasicTreeMutex &) = delete;
 
-    TreeMutex &operator=(const TreeMutex &) = delete;
+    BasicTreeMutex &operator=(const BasicTreeMutex &) = delete;
 
     void lock(std::size_t id);
 
     void unlock(std::size_t id);
 
+    Stats &GetStats() {
+        return stats_;
+    }
+
 private:
     static std::size_t tree_size(std::size_t n_threads);
 
     static std::size_t get_bit(std::size_t n, std::size_t mask);
 
     std::vector<peterson_mutex> mutexes_;
+    [[no_unique_address]] Stats stats_;
 };
 
+using TreeMutex = BasicTreeMutex<>;
+
 peterson_mutex::peterson_mutex() {
     victim_.store(0);
     want_[0].store(false);
     want_[1].store(false);
 }
 
-void peterson_mutex::lock(std::size_t id) {
+template <class Probe>
+void peterson_mutex::lock(std::size_t id, Probe &probe) {
     want_[id].store(true);
     victim_.store(id);
 
-    while (want_[other(id)].load() && victim_.load() == id)
+    while (want_[other(id)].load() && victim_.load() == id) {
+        probe.Spin();
         std::this_thread::yield();
+    }
 }
 
 void peterson_mutex::unlock(std::size_t id) {
@@ -63,19 +78,25 @@ std::size_t peterson_mutex::other(std::size_t id) {
     return 1 - id;
 }
 
-TreeMutex::TreeMutex(std::size_t n_threads) : mutexes_(tree_size(n_threads)) {}
+template <class Stats>
+BasicTreeMutex<Stats>::BasicTreeMutex(std::size_t n_threads) : mutexes_(tree_size(n_threads)) {}
 
-void TreeMutex::lock(std::size_t id) {
+template <class Stats>
+void BasicTreeMutex<Stats>::lock(std::size_t id) {
+    auto probe = stats_.BeginAcquire();
     std::size_t mutex_id = mutexes_.size() + id;
 
     do {
         std::size_t local_id = 1 - mutex_id % 2;
         mutex_id = (mutex_id - 1) / 2;
-        mutexes_[mutex_id].lock(local_id);
+        mutexes_[mutex_id].lock(local_id, probe);
     } while (mutex_id > 0);
+    stats_.EndAcquire(probe);
 }
 
-void TreeMutex::unlock(std::size_t id) {
+template <class Stats>
+void BasicTreeMutex<Stats>::unlock(std::size_t id) {
+    stats_.Release();
     // tree path is restored by bits of thread number
     std::size_t mask = (mutexes_.size() + 1) / 2; // higher bit of thread id
     std::size_t mutex_id = 0;
@@ -87,7 +108,8 @@ void TreeMutex::unlock(std::size_t id) {
     }
 }
 
-std::size_t TreeMutex::tree_size(std::size_t n_threads) {
+template <class Stats>
+std::size_t BasicTreeMutex<Stats>::tree_size(std::size_t n_threads) {
     std::size_t size = 2;
 
     while (size < n_threads)
@@ -96,6 +118,7 @@ std::size_t TreeMutex::tree_size(std::size_t n_threads) {
     return size - 1;
 }
 
-std::size_t TreeMutex::get_bit(std::size_t n, std::size_t mask) {
+template <class Stats>
+std::size_t BasicTreeMutex<Stats>::get_bit(std::size_t n, std::size_t mask) {
     return n & mask ? 1 : 0;
 }
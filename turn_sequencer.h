@@ -0,0 +1,73 @@
+#pragma once
+
+#include "futex.h"
+#include "spin_wait.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+// Strict round-robin handoff between N >= 2 stages (generalized Robot):
+// stage i runs only after stage i - 1, stage 0 runs after stage N - 1.
+// The whole ring shares one padded turn word, waiters spin first and then
+// sleep on the futex; the passer enters the kernel only if someone sleeps.
+
+class TurnSequencer {
+ public:
+  explicit TurnSequencer(const size_t num_stages)
+      : num_stages_(static_cast<uint32_t>(num_stages)) {
+    assert(num_stages >= 2);
+  }
+
+  TurnSequencer(const TurnSequencer&) = delete;
+  TurnSequencer& operator=(const TurnSequencer&) = delete;
+
+  template <typename Callback>
+  void Step(const size_t stage, Callback&& callback) {
+    WaitForTurn(static_cast<uint32_t>(stage));
+    std::forward<Callback>(callback)();
+    PassTurn(static_cast<uint32_t>(stage));
+  }
+
+  size_t NumStages() const {
+    return num_stages_;
+  }
+
+ private:
+  void WaitForTurn(const uint32_t stage) {
+    SpinWait spin_wait;
+    while (turn_.load(std::memory_order_acquire) != stage) { // (1)
+      if (!spin_wait.SpinOnce()) {
+        Sleep(stage);
+        return;
+      }
+    }
+  }
+
+  void Sleep(const uint32_t stage) {
+    sleepers_.fetch_add(1); // (2)
+    uint32_t curr_turn = turn_.load(); // (3)
+    while (curr_turn != stage) {
+      FutexWait(turn_, curr_turn);
+      curr_turn = turn_.load();
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void PassTurn(const uint32_t stage) {
+    const uint32_t next = stage + 1 == num_stages_ ? 0 : stage + 1;
+    // seq_cst store + load pair with (2)-(3): either the sleeper sees the
+    // new turn or we see the sleeper
+    turn_.store(next); // (4)
+    if (sleepers_.load() > 0) { // (5)
+      FutexWakeAll(turn_);
+    }
+  }
+
+ private:
+  const uint32_t num_stages_;
+  alignas(64) std::atomic<uint32_t> turn_{0};
+  std::atomic<uint32_t> sleepers_{0};
+  char pad_[64 - 2 * sizeof(std::atomic<uint32_t>)];
+};